@@ -0,0 +1,322 @@
+#include "bench.h"
+#include "particles.h"
+#include "profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+enum
+{
+    PHASE_SIM,              // game_tick
+    PHASE_DRAW,             // sprites et texte sur la surface de la fenetre
+    PHASE_PARTICLES,        // emission et particles_update
+    PHASE_PARTICLES_DRAW,   // effacement, dessin additif et collage
+    PHASE_NB
+};
+
+static const char *phase_names[PHASE_NB]={"sim","draw","particles","particles_draw"};
+
+typedef struct
+{
+    long long ns[PHASE_NB];
+    long long entities[PHASE_NB];   // entites traitees, sommees sur les ticks
+} Bench_result;
+
+typedef struct
+{
+    const char *name;
+    int ticks;
+    int (*run)(const Bench_env *env,int ticks,Bench_result *r);
+    const char *what;
+} Bench_scene;
+
+// le joueur fait des allers-retours de 200 ticks et tire tous les 50
+static void script_input(int tick,Input_snapshot *in)
+{
+    Input_tick t;
+    int k=(tick/200)%2==0 ? KEY_RIGHT : KEY_LEFT;
+    memset(&t,0,sizeof(t));
+    t.down=KEY_BIT(k);
+    t.held[k]=INPUT_STEPS;
+    if (tick%50==0)
+    {
+        t.down|=KEY_BIT(KEY_LCTRL);
+        t.pressed|=KEY_BIT(KEY_LCTRL);
+        t.held[KEY_LCTRL]=INPUT_STEPS;
+    }
+    input_expand(&t,in);
+}
+
+static int live(const Game *g)
+{
+    int j,n=g->nb_rocks+g->b;
+    for (j=0;j<NB_ALIENS;j++)
+    {
+        if (path_launched(&g->paths[j]))
+        {n++;}
+    }
+    return n;
+}
+
+static int drawn(const Frame *f)
+{
+    int j,n=1+f->nb_rocks+f->flying;
+    for (j=0;j<NB_ALIENS;j++)
+    {n+=f->alien_moved[j];}
+    return n;
+}
+
+// nb_games parties cote a cote, chacune regarnie a chaque tick (hors mesure)
+// jusqu'a aliens ennemis et rocks bals
+static int run_games(const Bench_env *env,int ticks,Bench_result *r,int nb_games,int aliens,int rocks)
+{
+    Game **games=(Game**)calloc(nb_games,sizeof(Game*));
+    Frame f;
+    Input_snapshot in;
+    long long t0;
+    int i,t,ok=games!=NULL && frame_init(&f,SHOTS_MAX)==0;
+    for (i=0;ok && i<nb_games;i++)
+    {
+        games[i]=game_new(env->w,env->h,env->plane,env->alien,env->fireball,env->rock);
+        ok=games[i]!=NULL;
+        if (ok)
+        {game_reset(games[i],BENCH_SEED+i);}
+    }
+    for (t=0;ok && t<ticks;t++)
+    {
+        script_input(t,&in);
+        for (i=0;i<nb_games;i++)
+        {
+            game_populate(games[i],aliens,rocks);
+            t0=prof_now_ns();
+            game_tick(games[i],&in,&f);
+            r->ns[PHASE_SIM]+=prof_now_ns()-t0;
+            r->entities[PHASE_SIM]+=live(games[i]);
+            if (env->frame!=NULL)
+            {
+                t0=prof_now_ns();
+                env->frame(env->ctx,&f);
+                r->ns[PHASE_DRAW]+=prof_now_ns()-t0;
+                r->entities[PHASE_DRAW]+=drawn(&f);
+            }
+        }
+    }
+    for (i=0;games!=NULL && i<nb_games;i++)
+    {game_delete(games[i]);}
+    free(games);
+    frame_free(&f);
+    return ok ? 0 : -1;
+}
+
+static int scene_menu(const Bench_env *env,int ticks,Bench_result *r)
+{
+    long long t0;
+    int t;
+    if (env->menu==NULL)
+    {return -1;}
+    for (t=0;t<ticks;t++)
+    {
+        t0=prof_now_ns();
+        env->menu(env->ctx);
+        r->ns[PHASE_DRAW]+=prof_now_ns()-t0;
+        r->entities[PHASE_DRAW]+=1;
+    }
+    return 0;
+}
+
+static int scene_aliens(const Bench_env *env,int ticks,Bench_result *r)
+{
+    return run_games(env,ticks,r,1,NB_ALIENS,0);
+}
+
+// un etat ne porte que NB_ALIENS ennemis: mille, ce sont 25 parties de front
+static int scene_aliens_1k(const Bench_env *env,int ticks,Bench_result *r)
+{
+    return run_games(env,ticks,r,1000/NB_ALIENS,NB_ALIENS,0);
+}
+
+static int scene_shots(const Bench_env *env,int ticks,Bench_result *r)
+{
+    return run_games(env,ticks,r,1,0,50000);
+}
+
+static int scene_particles(const Bench_env *env,int ticks,Bench_result *r)
+{
+    Particles p;
+    Particle_layer l;
+    unsigned seed=BENCH_SEED;
+    long long t0;
+    int t,k,layer;
+    if (particles_init(&p,PARTICLES_MAX,0.95f,0.08f,255,120,30)!=0)
+    {return -1;}
+    layer=env->frame!=NULL && particles_layer_init(&l,env->w,env->h)==0;
+    for (t=0;t<ticks;t++)
+    {
+        t0=prof_now_ns();
+        for (k=0;k<4;k++) // quatre explosions par tick, de quoi remplir la reserve
+        {particles_burst(&p,(float)((t*97+k*331)%env->w),(float)((t*61+k*173)%(env->h*9/10)),2500,7.0f,45,&seed);}
+        particles_update(&p,env->w,env->h);
+        r->ns[PHASE_PARTICLES]+=prof_now_ns()-t0;
+        r->entities[PHASE_PARTICLES]+=p.count;
+        if (layer)
+        {
+            t0=prof_now_ns();
+            particles_erase(&l);
+            particles_draw(&l,&p);
+            particles_present(&l);
+            r->ns[PHASE_PARTICLES_DRAW]+=prof_now_ns()-t0;
+            r->entities[PHASE_PARTICLES_DRAW]+=p.count;
+        }
+    }
+    if (layer)
+    {particles_layer_free(&l);}
+    particles_free(&p);
+    return 0;
+}
+
+// les compteurs de munitions et de coeurs changent a chaque tick
+static int scene_hud(const Bench_env *env,int ticks,Bench_result *r)
+{
+    long long t0;
+    int t;
+    if (env->hud==NULL)
+    {return -1;}
+    for (t=0;t<ticks;t++)
+    {
+        t0=prof_now_ns();
+        env->hud(env->ctx,t%5,(t/5)%5);
+        r->ns[PHASE_DRAW]+=prof_now_ns()-t0;
+        r->entities[PHASE_DRAW]+=8;
+    }
+    return 0;
+}
+
+static const Bench_scene scenes[]=
+{
+    {"idle_menu",600,scene_menu,"le menu redessine a chaque image"},
+    {"aliens_40",1200,scene_aliens,"une partie, les 40 ennemis en vol"},
+    {"aliens_1k",600,scene_aliens_1k,"1000 ennemis: 25 parties de 40"},
+    {"shots_50k",600,scene_shots,"50000 bals ennemies contre l'avion"},
+    {"particle_storm",300,scene_particles,"10000 particules emises par tick, reserve pleine"},
+    {"hud_churn",600,scene_hud,"munitions et coeurs qui changent a chaque image"}
+};
+
+#define NB_SCENES ((int)(sizeof(scenes)/sizeof(scenes[0])))
+
+void bench_list(FILE *f)
+{
+    int i;
+    for (i=0;i<NB_SCENES;i++)
+    {fprintf(f,"  %-16s %5d ticks  %s\n",scenes[i].name,scenes[i].ticks,scenes[i].what);}
+}
+
+static char *read_text(const char *path)
+{
+    FILE *f=fopen(path,"rb");
+    char *text=NULL;
+    long size;
+    if (f==NULL)
+    {return NULL;}
+    fseek(f,0,SEEK_END);
+    size=ftell(f);
+    fseek(f,0,SEEK_SET);
+    if (size>=0)
+    {text=(char*)malloc(size+1);}
+    if (text!=NULL)
+    {text[fread(text,1,size,f)]='\0';}
+    fclose(f);
+    return text;
+}
+
+// ns par tick d'une phase dans la ligne de la scene, -1 si absente
+static double baseline_ns(const char *text,const char *scene,const char *phase)
+{
+    char key[64];
+    const char *line,*end,*p;
+    sprintf(key,"\"scenario\":\"%s\"",scene);
+    line=strstr(text,key);
+    if (line==NULL)
+    {return -1;}
+    end=strchr(line,'\n');
+    sprintf(key,"\"%s\":{\"ns_per_tick\":",phase);
+    p=strstr(line,key);
+    if (p==NULL || (end!=NULL && p>end))
+    {return -1;}
+    return atof(p+strlen(key));
+}
+
+static int report(FILE *f,const Bench_scene *s,int ticks,const Bench_result *r,const char *base,double threshold)
+{
+    long long total=0;
+    double ns,old;
+    int i,first=1,regressions=0;
+    for (i=0;i<PHASE_NB;i++)
+    {total+=r->ns[i];}
+    fprintf(f,"{\"scenario\":\"%s\",\"ticks\":%d,\"seed\":%u,\"ticks_per_s\":%.1f,\"peak_memory_kb\":%lld,\"phases\":{",
+            s->name,ticks,BENCH_SEED,total>0 ? ticks*1e9/total : 0.0,prof_peak_memory()/1024);
+    for (i=0;i<PHASE_NB;i++)
+    {
+        if (r->ns[i]==0)
+        {continue;}
+        fprintf(f,"%s\"%s\":{\"ns_per_tick\":%.1f",first ? "" : ",",phase_names[i],(double)r->ns[i]/ticks);
+        if (r->entities[i]>0)
+        {fprintf(f,",\"ns_per_entity\":%.2f,\"entities_per_tick\":%.1f",(double)r->ns[i]/r->entities[i],(double)r->entities[i]/ticks);}
+        fprintf(f,"}");
+        first=0;
+    }
+    fprintf(f,"}");
+    if (base!=NULL)
+    {
+        fprintf(f,",\"threshold\":%.3f,\"regressions\":[",threshold);
+        for (i=0;i<PHASE_NB;i++)
+        {
+            ns=(double)r->ns[i]/ticks;
+            old=baseline_ns(base,s->name,phase_names[i]);
+            if (r->ns[i]>0 && old>0 && ns>old*(1+threshold))
+            {
+                fprintf(f,"%s{\"phase\":\"%s\",\"baseline_ns\":%.1f,\"ns\":%.1f,\"ratio\":%.3f}",
+                        regressions>0 ? "," : "",phase_names[i],old,ns,ns/old);
+                regressions++;
+            }
+        }
+        fprintf(f,"]");
+    }
+    fprintf(f,"}");
+    return regressions;
+}
+
+int bench_run(FILE *f,const char *scenario,int ticks,const Bench_env *env,const char *baseline,double threshold)
+{
+    Bench_result r;
+    char *base=NULL;
+    int i,n,done=0,regressions=0;
+    if (baseline!=NULL)
+    {
+        base=read_text(baseline);
+        if (base==NULL)
+        {fprintf(stderr,"bench: %s illisible, pas de comparaison\n",baseline);}
+    }
+    fprintf(f,"[\n");
+    for (i=0;i<NB_SCENES;i++)
+    {
+        if (strcmp(scenario,"all")!=0 && strcmp(scenario,scenes[i].name)!=0)
+        {continue;}
+        n=ticks>0 ? ticks : scenes[i].ticks;
+        memset(&r,0,sizeof(r));
+        if (scenes[i].run(env,n,&r)!=0)
+        {
+            fprintf(stderr,"bench: %s impossible ici\n",scenes[i].name);
+            continue;
+        }
+        if (done>0)
+        {fprintf(f,",\n");}
+        regressions+=report(f,&scenes[i],n,&r,base,threshold);
+        fflush(f);
+        done++;
+    }
+    fprintf(f,"\n]\n");
+    free(base);
+    if (done==0 && strcmp(scenario,"all")!=0)
+    {return -1;}
+    return regressions;
+}
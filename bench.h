@@ -0,0 +1,45 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include "collision.h"
+#include "game.h"
+
+// scenes de mesure scriptees: toujours la meme graine et les memes entrees, un nombre
+// fixe de ticks, rien d'affiche a l'ecran (le dessin va sur la surface de la fenetre
+// sans MLV_actualise_window). Resultat en JSON, une scene par ligne
+#define BENCH_SEED 12345u
+
+enum // sprites dessines un par un (mode de charge)
+{
+    BENCH_PLANE,
+    BENCH_ALIEN,
+    BENCH_ROCK,
+    BENCH_FIREBALL,
+    BENCH_NB_SPRITES
+};
+
+// ce que le banc recoit de main.cpp: la taille de la fenetre, les masques des sprites
+// et le dessin, qui y reste (NULL: les scenes qui dessinent ne mesurent que la simulation)
+typedef struct
+{
+    int w,h;
+    const Mask *plane;
+    const Mask *alien;
+    const Mask *fireball;
+    const Mask *rock;
+    void (*menu)(void *ctx);
+    void (*hud)(void *ctx,int c,int health);
+    void (*frame)(void *ctx,const Frame *f);
+    void (*sprite)(void *ctx,int sprite,int x,int y);
+    void *ctx;
+} Bench_env;
+
+void bench_list(FILE *f);
+// scenario: un nom de bench_list ou "all"; ticks<=0: le nombre propre a chaque scene.
+// baseline: sortie JSON d'un passage precedent, chaque phase plus lente de plus de
+// threshold (0.10: 10%) est une regression. Rend -1 si la scene n'existe pas, sinon
+// le nombre de regressions
+int bench_run(FILE *f,const char *scenario,int ticks,const Bench_env *env,const char *baseline,double threshold);
+
+#endif
@@ -0,0 +1,611 @@
+#include "broadphase.h"
+#include "jobs.h"
+#include "profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// methode fixe par scene, pour que les paires sortent toujours dans le meme ordre.
+// Mesure a l'echelle du jeu: les bals d'une partie (salves) vont plus vite en grille
+// de 500 a 50000 bals; ennemis et tirs melanges (bande, ecran) en sap des 2000 boites
+static const int scene_method[BP_NB_SCENES]={BP_SAP,BP_SAP,BP_GRID};
+
+int bp_init(Broadphase *bp,int cap,int scene)
+{
+    memset(bp,0,sizeof(Broadphase));
+    bp->cap=cap;
+    bp->method=scene_method[scene];
+    bp->cells_cap=cap*4;
+    bp->boxes=(Bp_box*)malloc(cap*sizeof(Bp_box));
+    bp->order=(int*)malloc(cap*sizeof(int));
+    bp->scratch=(int*)malloc(cap*sizeof(int));
+    bp->sorted=(int*)malloc(cap*sizeof(int));
+    bp->head=(int*)malloc(BP_BUCKETS*BP_LAYERS*sizeof(int));
+    bp->used=(int*)malloc(BP_BUCKETS*sizeof(int));
+    bp->seen=(unsigned char*)calloc(BP_BUCKETS,1);
+    bp->cell_x=(int*)malloc(bp->cells_cap*sizeof(int));
+    bp->cell_y=(int*)malloc(bp->cells_cap*sizeof(int));
+    bp->cell_box=(int*)malloc(bp->cells_cap*sizeof(int));
+    bp->cell_next=(int*)malloc(bp->cells_cap*sizeof(int));
+    if (bp->boxes==NULL || bp->order==NULL || bp->scratch==NULL || bp->sorted==NULL
+        || bp->head==NULL || bp->used==NULL || bp->seen==NULL
+        || bp->cell_x==NULL || bp->cell_y==NULL || bp->cell_box==NULL || bp->cell_next==NULL)
+    {
+        bp_free(bp);
+        return -1;
+    }
+    memset(bp->head,-1,BP_BUCKETS*BP_LAYERS*sizeof(int));
+    return 0;
+}
+
+void bp_free(Broadphase *bp)
+{
+    free(bp->boxes);
+    free(bp->order);
+    free(bp->scratch);
+    free(bp->sorted);
+    free(bp->head);
+    free(bp->used);
+    free(bp->seen);
+    free(bp->cell_x);
+    free(bp->cell_y);
+    free(bp->cell_box);
+    free(bp->cell_next);
+    memset(bp,0,sizeof(Broadphase));
+}
+
+void bp_clear(Broadphase *bp)
+{
+    bp->count=0;
+}
+
+int bp_add(Broadphase *bp,int x0,int y0,int x1,int y1,int layer,int mask)
+{
+    Bp_box *b;
+    if (bp->count>=bp->cap)
+    {return -1;}
+    b=&bp->boxes[bp->count];
+    b->x0=x0;
+    b->y0=y0;
+    b->x1=x1;
+    b->y1=y1;
+    b->layer=layer;
+    b->mask=mask;
+    return bp->count++;
+}
+
+static inline int interact(const Bp_box *a,const Bp_box *b)
+{
+    return (a->mask&b->layer)!=0 || (b->mask&a->layer)!=0;
+}
+
+static inline int emit(Bp_pair *pairs,int n,int a,int b)
+{
+    pairs[n].a=a<b ? a : b;
+    pairs[n].b=a<b ? b : a;
+    return n+1;
+}
+
+static inline int layer_index(int layer)
+{
+    int l=layer!=0 ? __builtin_ctz((unsigned)layer) : 0;
+    return l<BP_LAYERS ? l : BP_LAYERS-1;
+}
+
+// deux couches se testent si l'une des boites de l'une vise l'autre
+static inline int linked(const Broadphase *bp,int la,int lb)
+{
+    return (bp->links[la]>>lb&1) || (bp->links[lb]>>la&1);
+}
+
+// masques reunis par couche, et les couches qui ont au moins un couple; rend 0 si aucune
+static int gather_links(Broadphase *bp)
+{
+    int i,la,lb;
+    memset(bp->links,0,sizeof(bp->links));
+    bp->active=0;
+    for (i=0;i<bp->count;i++)
+    {bp->links[layer_index(bp->boxes[i].layer)]|=bp->boxes[i].mask;}
+    for (la=0;la<BP_LAYERS;la++)
+    {
+        for (lb=la;lb<BP_LAYERS;lb++)
+        {
+            if (linked(bp,la,lb))
+            {bp->active|=(1<<la)|(1<<lb);}
+        }
+    }
+    return bp->active!=0;
+}
+
+// un intervalle de X contre la liste Y, toutes deux triees sur x0 (indices des boites).
+// self: X==Y, on ne regarde qu'apres i. Sinon seulement les boites de Y qui commencent
+// a partir de a (strict: apres a), pour que chaque paire ne sorte que d'un cote.
+// Les paires sont ecrites a partir de pairs[first] tant qu'on reste sous limit
+// (pairs==NULL: on compte seulement)
+static int sweep_range(const Broadphase *bp,const int *X,int begin,int end,const int *Y,int ny,int self,int strict,
+                       Bp_pair *pairs,int first,int limit)
+{
+    const Bp_box *B=bp->boxes;
+    int np=0,i,j,k,lo,hi;
+    for (i=begin;i<end;i++)
+    {
+        const Bp_box *a=&B[X[i]];
+        if (self)
+        {j=i+1;}
+        else
+        {
+            lo=0;
+            hi=ny;
+            while (lo<hi)
+            {
+                k=(lo+hi)/2;
+                if (B[Y[k]].x0<a->x0 || (strict && B[Y[k]].x0==a->x0))
+                {lo=k+1;}
+                else
+                {hi=k;}
+            }
+            j=lo;
+        }
+        for (;j<ny;j++)
+        {
+            k=Y[j];
+            if (B[k].x0>=a->x1)
+            {break;}
+            if (B[k].y0<a->y1 && a->y0<B[k].y1 && interact(a,&B[k]))
+            {
+                if (pairs!=NULL)
+                {
+                    if (first+np>=limit)
+                    {return np;}
+                    emit(pairs,first+np,X[i],k);
+                }
+                np++;
+            }
+        }
+    }
+    return np;
+}
+
+// en parallele: on compte par morceau, puis chaque morceau ecrit a son rang;
+// les paires sortent dans le meme ordre qu'en un seul thread
+#define BP_GRAIN 1024
+
+typedef struct
+{
+    const Broadphase *bp;
+    const int *X,*Y;
+    int ny,self,strict;
+    Bp_pair *pairs;
+    int max_pairs;
+    int count[JOBS_MAX_CHUNKS];
+    int offset[JOBS_MAX_CHUNKS];
+} Sweep_job;
+
+static void sweep_count(void *ctx,int chunk,int begin,int end)
+{
+    Sweep_job *j=(Sweep_job*)ctx;
+    j->count[chunk]=sweep_range(j->bp,j->X,begin,end,j->Y,j->ny,j->self,j->strict,NULL,0,0);
+}
+
+static void sweep_write(void *ctx,int chunk,int begin,int end)
+{
+    Sweep_job *j=(Sweep_job*)ctx;
+    if (j->offset[chunk]<j->max_pairs)
+    {sweep_range(j->bp,j->X,begin,end,j->Y,j->ny,j->self,j->strict,j->pairs,j->offset[chunk],j->max_pairs);}
+}
+
+// une liste contre une autre; rend le nouveau nombre de paires
+static int sweep_lists(const Broadphase *bp,const int *X,int nx,const int *Y,int ny,int self,int strict,
+                       Bp_pair *pairs,int np,int max_pairs)
+{
+    static Sweep_job job;
+    int nc,c,total=np;
+    if (nx==0 || ny==0 || np>=max_pairs)
+    {return np;}
+    if (jobs_threads()<=1 || nx<2*BP_GRAIN)
+    {return np+sweep_range(bp,X,0,nx,Y,ny,self,strict,pairs,np,max_pairs);}
+    job.bp=bp;
+    job.X=X;
+    job.Y=Y;
+    job.ny=ny;
+    job.self=self;
+    job.strict=strict;
+    job.pairs=pairs;
+    job.max_pairs=max_pairs;
+    nc=jobs_parallel_for(sweep_count,&job,nx,BP_GRAIN);
+    for (c=0;c<nc;c++)
+    {
+        job.offset[c]=total;
+        total+=job.count[c];
+    }
+    jobs_parallel_for(sweep_write,&job,nx,BP_GRAIN);
+    return total<max_pairs ? total : max_pairs;
+}
+
+// ordre total sur (x0, indice): le resultat ne depend pas de l'ordre du tick precedent,
+// une partie rechargee depuis une image cle sort les memes paires
+static inline int before(const Bp_box *B,int a,int b)
+{
+    return B[a].x0<B[b].x0 || (B[a].x0==B[b].x0 && a<b);
+}
+
+// tri par base sur x0 (trois passes de 11 bits), depuis 0..n-1: stable, donc a x0 egal
+// les indices restent croissants
+#define BP_RADIX 11
+
+static void radix_order(Broadphase *bp)
+{
+    const Bp_box *B=bp->boxes;
+    int *src=bp->order,*dst=bp->scratch,*t;
+    int n=bp->count,i,shift,count[(1<<BP_RADIX)+1];
+    unsigned key;
+    for (i=0;i<n;i++)
+    {src[i]=i;}
+    for (shift=0;shift<32;shift+=BP_RADIX)
+    {
+        memset(count,0,sizeof(count));
+        for (i=0;i<n;i++)
+        {
+            key=((unsigned)B[i].x0)^0x80000000u;
+            count[(key>>shift&((1<<BP_RADIX)-1))+1]++;
+        }
+        for (i=0;i<(1<<BP_RADIX);i++)
+        {count[i+1]+=count[i];}
+        for (i=0;i<n;i++)
+        {
+            key=((unsigned)B[src[i]].x0)^0x80000000u;
+            dst[count[key>>shift&((1<<BP_RADIX)-1)]++]=src[i];
+        }
+        t=src;
+        src=dst;
+        dst=t;
+    }
+    if (src!=bp->order)
+    {memcpy(bp->order,src,n*sizeof(int));}
+}
+
+// les entites bougent peu entre deux ticks: le tri par insertion ne deplace presque rien.
+// Quand il deplace trop (beaucoup d'apparitions, pool tassee), on repart d'un tri par base
+static void sort_order(Broadphase *bp)
+{
+    const Bp_box *B=bp->boxes;
+    int *order=bp->order;
+    int n=bp->count,i,j,key;
+    long long moves=0,budget=4LL*n+1024;
+    // garder exactement les indices 0..count-1, dans l'ordre du tick precedent
+    if (bp->ordered>n)
+    {
+        for (i=0,j=0;i<bp->ordered;i++)
+        {
+            if (order[i]<n)
+            {order[j++]=order[i];}
+        }
+    }
+    for (i=bp->ordered<n ? bp->ordered : n;i<n;i++)
+    {order[i]=i;}
+    bp->ordered=n;
+    for (i=1;i<n;i++)
+    {
+        key=order[i];
+        for (j=i-1;j>=0 && before(B,key,order[j]);j--)
+        {order[j+1]=order[j];}
+        order[j+1]=key;
+        moves+=i-1-j;
+        if (moves>budget)
+        {
+            radix_order(bp);
+            return;
+        }
+    }
+}
+
+// l'ordre trie, reparti par couche: chaque couche garde son tri
+static void split_layers(Broadphase *bp)
+{
+    int pos[BP_LAYERS],l,i;
+    memset(bp->first,0,sizeof(bp->first));
+    for (i=0;i<bp->count;i++)
+    {bp->first[layer_index(bp->boxes[i].layer)+1]++;}
+    for (l=0;l<BP_LAYERS;l++)
+    {
+        bp->first[l+1]+=bp->first[l];
+        pos[l]=bp->first[l];
+    }
+    for (i=0;i<bp->count;i++)
+    {bp->sorted[pos[layer_index(bp->boxes[bp->order[i]].layer)]++]=bp->order[i];}
+}
+
+// une liste triee par couche, et seulement les couples de couches qui se touchent:
+// des milliers de bals qui ne se testent pas entre elles ne coutent que leur tri
+static int pairs_sap(Broadphase *bp,Bp_pair *pairs,int max_pairs)
+{
+    const int *S=bp->sorted;
+    const int *F=bp->first;
+    int np=0,la,lb;
+    sort_order(bp);
+    split_layers(bp);
+    for (la=0;la<BP_LAYERS;la++)
+    {
+        for (lb=la;lb<BP_LAYERS;lb++)
+        {
+            if (!linked(bp,la,lb))
+            {continue;}
+            if (la==lb)
+            {np=sweep_lists(bp,S+F[la],F[la+1]-F[la],S+F[la],F[la+1]-F[la],1,0,pairs,np,max_pairs);}
+            else
+            {
+                np=sweep_lists(bp,S+F[la],F[la+1]-F[la],S+F[lb],F[lb+1]-F[lb],0,0,pairs,np,max_pairs);
+                np=sweep_lists(bp,S+F[lb],F[lb+1]-F[lb],S+F[la],F[la+1]-F[la],0,1,pairs,np,max_pairs);
+            }
+        }
+    }
+    return np;
+}
+
+static inline int bucket_of(int cx,int cy)
+{
+    return (int)(((unsigned)cx*73856093u)^((unsigned)cy*19349663u))&(BP_BUCKETS-1);
+}
+
+static int grow(int **a,int cap)
+{
+    int *n=(int*)realloc(*a,cap*sizeof(int));
+    if (n==NULL)
+    {return -1;}
+    *a=n;
+    return 0;
+}
+
+// une chaine par seau et par couche
+static int grid_insert(Broadphase *bp,int cx,int cy,int box,int l)
+{
+    int h=bucket_of(cx,cy),c,u;
+    if (bp->nb_cells>=bp->cells_cap)
+    {
+        int cap=bp->cells_cap*2;
+        if (grow(&bp->cell_x,cap)!=0 || grow(&bp->cell_y,cap)!=0
+            || grow(&bp->cell_box,cap)!=0 || grow(&bp->cell_next,cap)!=0)
+        {return -1;}
+        bp->cells_cap=cap;
+    }
+    c=bp->nb_cells++;
+    bp->cell_x[c]=cx;
+    bp->cell_y[c]=cy;
+    bp->cell_box[c]=box;
+    if (bp->seen[h]==0)
+    {
+        bp->seen[h]=1;
+        bp->used[bp->nb_used++]=h;
+    }
+    u=h*BP_LAYERS+l;
+    bp->cell_next[c]=bp->head[u];
+    bp->head[u]=c;
+    return 0;
+}
+
+static int grid_cell_pairs(Broadphase *bp,int p,int q0,Bp_pair *pairs,int np,int max_pairs)
+{
+    const Bp_box *B=bp->boxes;
+    int q,a,b,rx,ry;
+    for (q=q0;q>=0;q=bp->cell_next[q])
+    {
+        if (bp->cell_x[p]!=bp->cell_x[q] || bp->cell_y[p]!=bp->cell_y[q])
+        {continue;}
+        a=bp->cell_box[p];
+        b=bp->cell_box[q];
+        if (!interact(&B[a],&B[b]) || B[a].x0>=B[b].x1 || B[b].x0>=B[a].x1
+            || B[a].y0>=B[b].y1 || B[b].y0>=B[a].y1)
+        {continue;}
+        // une paire partage plusieurs cellules: on ne la garde que dans celle
+        // qui contient le coin haut gauche de l'intersection
+        rx=(B[a].x0>B[b].x0 ? B[a].x0 : B[b].x0)>>BP_CELL_SHIFT;
+        ry=(B[a].y0>B[b].y0 ? B[a].y0 : B[b].y0)>>BP_CELL_SHIFT;
+        if (rx!=bp->cell_x[p] || ry!=bp->cell_y[p])
+        {continue;}
+        if (np>=max_pairs)
+        {return np;}
+        np=emit(pairs,np,a,b);
+    }
+    return np;
+}
+
+static int pairs_grid(Broadphase *bp,Bp_pair *pairs,int max_pairs)
+{
+    const Bp_box *B=bp->boxes;
+    int np=0,i,u,p,h,l,la,lb,cx,cy;
+    for (u=0;u<bp->nb_used;u++)
+    {
+        h=bp->used[u];
+        bp->seen[h]=0;
+        for (l=0;l<BP_LAYERS;l++)
+        {bp->head[h*BP_LAYERS+l]=-1;}
+    }
+    bp->nb_used=0;
+    bp->nb_cells=0;
+    for (i=0;i<bp->count;i++)
+    {
+        l=layer_index(B[i].layer);
+        if (!(bp->active>>l&1)) // couche qui ne touche rien: pas dans la grille
+        {continue;}
+        for (cy=B[i].y0>>BP_CELL_SHIFT;cy<=(B[i].y1-1)>>BP_CELL_SHIFT;cy++)
+        {
+            for (cx=B[i].x0>>BP_CELL_SHIFT;cx<=(B[i].x1-1)>>BP_CELL_SHIFT;cx++)
+            {
+                if (grid_insert(bp,cx,cy,i,l)!=0)
+                {return 0;}
+            }
+        }
+    }
+    for (u=0;u<bp->nb_used;u++)
+    {
+        h=bp->used[u]*BP_LAYERS;
+        for (la=0;la<BP_LAYERS;la++)
+        {
+            for (lb=la;lb<BP_LAYERS;lb++)
+            {
+                if (!linked(bp,la,lb))
+                {continue;}
+                for (p=bp->head[h+la];p>=0 && np<max_pairs;p=bp->cell_next[p])
+                {np=grid_cell_pairs(bp,p,la==lb ? bp->cell_next[p] : bp->head[h+lb],pairs,np,max_pairs);}
+            }
+        }
+    }
+    return np;
+}
+
+int bp_pairs(Broadphase *bp,Bp_pair *pairs,int max_pairs)
+{
+    if (!gather_links(bp))
+    {return 0;}
+    if (bp->method==BP_GRID)
+    {return pairs_grid(bp,pairs,max_pairs);}
+    return pairs_sap(bp,pairs,max_pairs);
+}
+
+const char *bp_method_name(int method)
+{
+    return method==BP_GRID ? "grille" : "sap";
+}
+
+// ------------------------------------------------------------------ mesure
+
+typedef struct
+{
+    int x,y,vx,vy,w,h,layer;
+} Bench_entity;
+
+static const char *scene_names[BP_NB_SCENES]={"bande","ecran","salves"};
+
+static int bench_rand(unsigned *seed,int n)
+{
+    *seed=*seed*1103515245u+12345u;
+    return (int)((*seed>>8)%(unsigned)n);
+}
+
+static void bench_spawn(Bench_entity *e,int scene,int i,unsigned *seed)
+{
+    e->layer=i%4==0 ? 1 : 2; // un quart de cibles, le reste en tirs
+    e->w=e->layer==1 ? 120 : 16+bench_rand(seed,64);
+    e->h=e->layer==1 ? 100 : 16+bench_rand(seed,48);
+    switch (scene)
+    {
+        case BP_SCENE_BAND:
+            e->x=bench_rand(seed,1280);
+            e->y=bench_rand(seed,240);
+            e->vx=bench_rand(seed,3)-1;
+            e->vy=e->layer==1 ? 1 : -2-bench_rand(seed,7);
+            break;
+        case BP_SCENE_SCREEN:
+            e->x=bench_rand(seed,1280);
+            e->y=bench_rand(seed,960);
+            e->vx=bench_rand(seed,9)-4;
+            e->vy=bench_rand(seed,9)-4;
+            break;
+        default:
+            e->x=160*(1+i%7);
+            e->y=120;
+            e->vx=bench_rand(seed,13)-6;
+            e->vy=bench_rand(seed,13)-6;
+            break;
+    }
+}
+
+static void bench_step(Bench_entity *e,int n,int scene,unsigned *seed)
+{
+    int i;
+    for (i=0;i<n;i++)
+    {
+        e[i].x+=e[i].vx;
+        e[i].y+=e[i].vy;
+        if (e[i].x<-200 || e[i].x>1480 || e[i].y<-200 || e[i].y>1160)
+        {bench_spawn(&e[i],scene,i,seed);}
+    }
+}
+
+static int pair_cmp(const void *a,const void *b)
+{
+    const Bp_pair *p=(const Bp_pair*)a,*q=(const Bp_pair*)b;
+    if (p->a!=q->a)
+    {return p->a-q->a;}
+    return p->b-q->b;
+}
+
+void bp_bench(FILE *f,int n,int ticks)
+{
+    Broadphase bp[2];
+    Bench_entity *e=(Bench_entity*)malloc(n*sizeof(Bench_entity));
+    int max_pairs=n*64;
+    Bp_pair *pairs[2];
+    long long t[2],t0;
+    int scene,m,i,tick,np[2],same,full;
+    unsigned seed;
+    pairs[0]=(Bp_pair*)malloc(max_pairs*sizeof(Bp_pair));
+    pairs[1]=(Bp_pair*)malloc(max_pairs*sizeof(Bp_pair));
+    if (e==NULL || pairs[0]==NULL || pairs[1]==NULL || bp_init(&bp[0],n,0)!=0)
+    {
+        if (f!=NULL)
+        {fprintf(f,"broadphase bench: allocation impossible\n");}
+        free(e);
+        free(pairs[0]);
+        free(pairs[1]);
+        return;
+    }
+    if (bp_init(&bp[1],n,0)!=0)
+    {
+        bp_free(&bp[0]);
+        free(e);
+        free(pairs[0]);
+        free(pairs[1]);
+        return;
+    }
+    bp[0].method=BP_SAP;
+    bp[1].method=BP_GRID;
+    if (f!=NULL)
+    {
+        fprintf(f,"broadphase bench: %d boites x %d ticks\n",n,ticks);
+        fprintf(f,"  %-8s %12s %12s %9s  %-6s %s\n","scene","sap us/tick","grille us/tick","paires","mesure","en jeu");
+    }
+    for (scene=0;scene<BP_NB_SCENES;scene++)
+    {
+        seed=1;
+        for (i=0;i<n;i++)
+        {bench_spawn(&e[i],scene,i,&seed);}
+        t[0]=t[1]=0;
+        np[0]=np[1]=0;
+        same=1;
+        full=0;
+        for (tick=0;tick<ticks;tick++)
+        {
+            bench_step(e,n,scene,&seed);
+            for (m=0;m<2;m++)
+            {
+                bp_clear(&bp[m]);
+                for (i=0;i<n;i++)
+                {bp_add(&bp[m],e[i].x,e[i].y,e[i].x+e[i].w,e[i].y+e[i].h,e[i].layer,3-e[i].layer);}
+                t0=prof_now_ns();
+                np[m]=bp_pairs(&bp[m],pairs[m],max_pairs);
+                t[m]+=prof_now_ns()-t0;
+            }
+            if (np[0]>=max_pairs || np[1]>=max_pairs)
+            {full=1;}
+            else if (f!=NULL)
+            {
+                qsort(pairs[0],np[0],sizeof(Bp_pair),pair_cmp);
+                qsort(pairs[1],np[1],sizeof(Bp_pair),pair_cmp);
+                if (np[0]!=np[1] || memcmp(pairs[0],pairs[1],np[0]*sizeof(Bp_pair))!=0)
+                {same=0;}
+            }
+        }
+        if (f!=NULL)
+        {
+            fprintf(f,"  %-8s %12.1f %12.1f %9d  %-6s %s%s\n",scene_names[scene],t[0]/1000.0/ticks,t[1]/1000.0/ticks,
+                    np[0],bp_method_name(t[1]<t[0] ? BP_GRID : BP_SAP),bp_method_name(scene_method[scene]),
+                    !same ? "  PAIRES DIFFERENTES" : full ? "  (tampon de paires plein)" : "");
+        }
+    }
+    bp_free(&bp[0]);
+    bp_free(&bp[1]);
+    free(e);
+    free(pairs[0]);
+    free(pairs[1]);
+}
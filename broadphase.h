@@ -0,0 +1,74 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <stdio.h>
+
+// boite englobante d'une entite pour le tri grossier (mettre tout le trajet du tick)
+typedef struct
+{
+    int x0,y0,x1,y1;
+    int layer;  // couche de l'entite (un bit)
+    int mask;   // couches avec lesquelles elle interagit
+} Bp_box;
+
+typedef struct
+{
+    int a,b;    // indices des boites, a<b
+} Bp_pair;
+
+enum
+{
+    BP_SAP,     // intervalles tries sur x, tri par insertion d'un tick a l'autre
+    BP_GRID     // grille uniforme hachee
+};
+
+// types de scenes: chacune garde la methode la plus rapide mesuree
+enum
+{
+    BP_SCENE_BAND,    // bande large et basse (ennemis) traversee par des tirs verticaux
+    BP_SCENE_SCREEN,  // entites reparties sur tout l'ecran
+    BP_SCENE_BURST,   // salves qui partent de quelques emetteurs
+    BP_NB_SCENES
+};
+
+#define BP_CELL_SHIFT 7     // cellules de 128 px
+#define BP_BUCKETS 4096     // puissance de 2
+#define BP_LAYERS 8         // couches 1<<0 a 1<<7; au-dela elles partagent la derniere liste
+
+typedef struct
+{
+    Bp_box *boxes;  // remplies a chaque tick; l'indice doit suivre la meme entite pour profiter du tri
+    int count;
+    int cap;
+    int method;
+    int *order;     // sap: indices tries sur (x0, indice), gardes d'un tick a l'autre
+    int ordered;    // order contient exactement 0..ordered-1
+    int *scratch;   // sap: tri par base quand l'ordre precedent ne sert plus
+    int *sorted;    // sap: order reparti par couche, sorted[first[l]..first[l+1]-1]
+    int first[BP_LAYERS+1];
+    int links[BP_LAYERS];   // union des masques des boites de chaque couche
+    int active;             // couches qui ont au moins un couple a tester
+    int *head;      // grille: premiere inscription de chaque seau, par couche
+    int *used;      // seaux non vides, pour les vider sans tout parcourir
+    unsigned char *seen;
+    int nb_used;
+    int *cell_x,*cell_y,*cell_box,*cell_next; // inscriptions d'une boite dans une cellule
+    int nb_cells;
+    int cells_cap;
+} Broadphase;
+
+int bp_init(Broadphase *bp,int cap,int scene); // la methode est fixee par le type de scene
+void bp_free(Broadphase *bp);
+void bp_clear(Broadphase *bp);
+int bp_add(Broadphase *bp,int x0,int y0,int x1,int y1,int layer,int mask); // renvoie l'indice ou -1
+
+// paires de boites qui se chevauchent et dont l'une a la couche de l'autre dans son masque;
+// seuls les couples de couches qui interagissent sont parcourus. Renvoie le nombre ecrit
+int bp_pairs(Broadphase *bp,Bp_pair *pairs,int max_pairs);
+const char *bp_method_name(int method);
+
+// mesure sap et grille sur chaque type de scene, a cote de la methode fixe qu'elle utilise
+// en jeu; ne change rien a ce choix
+void bp_bench(FILE *f,int n,int ticks);
+
+#endif
@@ -0,0 +1,257 @@
+#include "collision.h"
+#include "jobs.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int mask_alloc(Mask *m,int w,int h)
+{
+    m->w=w;
+    m->h=h;
+    m->words=(w+63)/64;
+    m->bits=(unsigned long long*)calloc(m->words*h+1,sizeof(unsigned long long));
+    return m->bits!=NULL ? 0 : -1;
+}
+
+int mask_from_image(Mask *m,const MLV_Image *image)
+{
+    int w,h,x,y,r,g,b,a;
+    if (image==NULL)
+    {
+        memset(m,0,sizeof(Mask));
+        return -1;
+    }
+    MLV_get_image_size(image,&w,&h);
+    if (mask_alloc(m,w,h)!=0)
+    {return -1;}
+    for (y=0;y<h;y++)
+    {
+        for (x=0;x<w;x++)
+        {
+            MLV_get_pixel_on_image(image,x,y,&r,&g,&b,&a);
+            if (a>=128)
+            {m->bits[y*m->words+x/64]|=1ULL<<(x%64);}
+        }
+    }
+    return 0;
+}
+
+void mask_box(Mask *m,int w,int h)
+{
+    int x,y;
+    if (mask_alloc(m,w,h)!=0)
+    {return;}
+    for (y=0;y<h;y++)
+    {
+        for (x=0;x<w;x++)
+        {m->bits[y*m->words+x/64]|=1ULL<<(x%64);}
+    }
+}
+
+void mask_free(Mask *m)
+{
+    free(m->bits);
+    memset(m,0,sizeof(Mask));
+}
+
+// 64 pixels d'une ligne a partir du pixel s (s peut etre negatif)
+static inline unsigned long long row_bits(const unsigned long long *row,int words,int s)
+{
+    int k,o;
+    unsigned long long v;
+    if (s<0)
+    {return s<=-64 ? 0 : row[0]<<(-s);}
+    k=s>>6;
+    o=s&63;
+    if (k>=words)
+    {return 0;}
+    v=row[k]>>o;
+    if (o!=0 && k+1<words)
+    {v|=row[k+1]<<(64-o);}
+    return v;
+}
+
+int mask_overlap(const Mask *a,int ax,int ay,const Mask *b,int bx,int by)
+{
+    int dx=bx-ax;
+    int dy=by-ay;
+    int x0=dx>0 ? dx : 0;
+    int x1=dx+b->w<a->w ? dx+b->w : a->w;
+    int y0=dy>0 ? dy : 0;
+    int y1=dy+b->h<a->h ? dy+b->h : a->h;
+    int y,k;
+    if (a->bits==NULL || b->bits==NULL || x0>=x1 || y0>=y1)
+    {return 0;}
+    for (y=y0;y<y1;y++)
+    {
+        const unsigned long long *ra=a->bits+y*a->words;
+        const unsigned long long *rb=b->bits+(y-dy)*b->words;
+        // hors de b, row_bits renvoie des zeros: pas besoin de masquer x0..x1
+        for (k=x0>>6;k<=(x1-1)>>6;k++)
+        {
+            if (ra[k] & row_bits(rb,b->words,k*64-dx))
+            {return 1;}
+        }
+    }
+    return 0;
+}
+
+// intervalle de t ou a0+d*t est dans ]lo,hi[ sur un axe
+static int slab(int a0,int d,int lo,int hi,float *t0,float *t1)
+{
+    float u,v;
+    if (d==0)
+    {
+        *t0=0;
+        *t1=1;
+        return a0>lo && a0<hi;
+    }
+    u=(float)(lo-a0)/d;
+    v=(float)(hi-a0)/d;
+    *t0=u<v ? u : v;
+    *t1=u<v ? v : u;
+    return 1;
+}
+
+int box_sweep(int ax,int ay,int aw,int ah,int dx,int dy,int bx,int by,int bw,int bh,float *t_in,float *t_out)
+{
+    float x0,x1,y0,y1,t0,t1;
+    if (!slab(ax,dx,bx-aw,bx+bw,&x0,&x1) || !slab(ay,dy,by-ah,by+bh,&y0,&y1))
+    {return 0;}
+    t0=x0>y0 ? x0 : y0;
+    t1=x1<y1 ? x1 : y1;
+    if (t0<0)
+    {t0=0;}
+    if (t1>1)
+    {t1=1;}
+    if (t0>=t1)
+    {return 0;}
+    *t_in=t0;
+    *t_out=t1;
+    return 1;
+}
+
+int mask_sweep(const Mask *a,int ax,int ay,int dx,int dy,const Mask *b,int bx,int by,float *t)
+{
+    float t0,t1,u;
+    int len,n,s;
+    if (!box_sweep(ax,ay,a->w,a->h,dx,dy,bx,by,b->w,b->h,&t0,&t1))
+    {return 0;}
+    len=abs(dx)>abs(dy) ? abs(dx) : abs(dy);
+    n=(int)ceil(len*(t1-t0)/MASK_SWEEP_STEP);
+    for (s=0;s<=n;s++)
+    {
+        u=n>0 ? t0+(t1-t0)*s/n : t0;
+        if (mask_overlap(a,ax+(int)floor(dx*u+0.5f),ay+(int)floor(dy*u+0.5f),b,bx,by))
+        {
+            *t=u;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int body_contact(const Body *a,const Body *b,float *t)
+{
+    int dx,dy;
+    float t1;
+    // deplacement de a vu depuis b
+    dx=a->dx-b->dx;
+    dy=a->dy-b->dy;
+    if (a->mask==NULL || b->mask==NULL)
+    {return box_sweep(a->x-dx,a->y-dy,a->w,a->h,dx,dy,b->x,b->y,b->w,b->h,t,&t1);}
+    return mask_sweep(a->mask,a->x-dx,a->y-dy,dx,dy,b->mask,b->x,b->y,t);
+}
+
+// test fin d'une paire; renvoie 0 si les corps ne se touchent pas pendant le tick
+static int narrow(const Body *bodies,const Bp_pair *pair,Hit *hit)
+{
+    const Body *a=&bodies[pair->a],*b=&bodies[pair->b],*c;
+    float t;
+    if (a->layer>b->layer)
+    {
+        c=a;
+        a=b;
+        b=c;
+    }
+    if (!body_contact(a,b,&t))
+    {return 0;}
+    hit->a=(int)(a-bodies);
+    hit->b=(int)(b-bodies);
+    hit->t=t;
+    return 1;
+}
+
+// beaucoup de paires: une tache par morceau, un resultat par paire, puis on tasse dans l'ordre
+#define COLLIDE_GRAIN 128
+
+typedef struct
+{
+    const Body *bodies;
+    const Bp_pair *pairs;
+    Hit *out;   // out[i].a<0: pas de contact
+} Narrow_job;
+
+static Hit *pair_hits=NULL;
+static int pair_hits_cap=0;
+
+static void narrow_chunk(void *ctx,int chunk,int begin,int end)
+{
+    Narrow_job *j=(Narrow_job*)ctx;
+    int i;
+    for (i=begin;i<end;i++)
+    {
+        if (!narrow(j->bodies,&j->pairs[i],&j->out[i]))
+        {j->out[i].a=-1;}
+    }
+}
+
+int collide_pass(Broadphase *bp,const Body *bodies,int n,Bp_pair *pairs,int max_pairs,Hit *hits,int max_hits)
+{
+    const Body *a;
+    Narrow_job job;
+    Hit *grown;
+    int i,np,nh=0,x0,y0;
+    bp_clear(bp);
+    for (i=0;i<n;i++)
+    {
+        a=&bodies[i];
+        x0=a->x-a->dx;
+        y0=a->y-a->dy;
+        bp_add(bp,x0<a->x ? x0 : a->x,y0<a->y ? y0 : a->y,(x0>a->x ? x0 : a->x)+a->w,(y0>a->y ? y0 : a->y)+a->h,
+               a->layer,a->collides);
+    }
+    np=bp_pairs(bp,pairs,max_pairs);
+    if (jobs_threads()>1 && np>=2*COLLIDE_GRAIN)
+    {
+        if (np>pair_hits_cap)
+        {
+            grown=(Hit*)realloc(pair_hits,np*sizeof(Hit));
+            if (grown!=NULL)
+            {
+                pair_hits=grown;
+                pair_hits_cap=np;
+            }
+        }
+        if (np<=pair_hits_cap)
+        {
+            job.bodies=bodies;
+            job.pairs=pairs;
+            job.out=pair_hits;
+            jobs_parallel_for(narrow_chunk,&job,np,COLLIDE_GRAIN);
+            for (i=0;i<np && nh<max_hits;i++)
+            {
+                if (pair_hits[i].a>=0)
+                {hits[nh++]=pair_hits[i];}
+            }
+            return nh;
+        }
+    }
+    for (i=0;i<np && nh<max_hits;i++)
+    {
+        if (narrow(bodies,&pairs[i],&hits[nh]))
+        {nh++;}
+    }
+    return nh;
+}
@@ -0,0 +1,88 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <MLV/MLV_all.h>
+#include "broadphase.h"
+
+// masque de collision: 1 bit par pixel, lignes de mots de 64 bits,
+// le pixel x d'une ligne est le bit x%64 du mot x/64
+typedef struct
+{
+    int w;
+    int h;
+    int words;  // mots par ligne
+    unsigned long long *bits;
+} Mask;
+
+int mask_from_image(Mask *m,const MLV_Image *image); // pixels avec alpha >= 128
+void mask_box(Mask *m,int w,int h);                  // masque plein, si pas d'image
+void mask_free(Mask *m);
+
+// test fin, a faire apres box_overlap: ET de mots de 64 bits sur la zone commune
+int mask_overlap(const Mask *a,int ax,int ay,const Mask *b,int bx,int by);
+
+// boite a qui se deplace de (dx,dy) depuis (ax,ay) contre la boite fixe b:
+// renvoie 1 si elles se touchent pendant le deplacement, avec l'entree et la sortie en fraction [0,1]
+// (pour deux objets mobiles, passer le deplacement relatif de a par rapport a b)
+int box_sweep(int ax,int ay,int aw,int ah,int dx,int dy,int bx,int by,int bw,int bh,float *t_in,float *t_out);
+
+// idem au pixel pres: les masques sont testes le long du segment, pas de MASK_SWEEP_STEP pixels,
+// seulement entre l'entree et la sortie des boites; t recoit l'instant du premier contact
+#define MASK_SWEEP_STEP 2
+int mask_sweep(const Mask *a,int ax,int ay,int dx,int dy,const Mask *b,int bx,int by,float *t);
+
+static inline int box_overlap(int ax,int ay,int aw,int ah,int bx,int by,int bw,int bh)
+{
+    return ax<bx+bw && bx<ax+aw && ay<by+bh && by<ay+ah;
+}
+
+// couches du jeu: un bit chacune
+enum
+{
+    LAYER_PLANE=1,
+    LAYER_FIREBALL=2,
+    LAYER_ALIEN=4,
+    LAYER_ROCK=8,
+    LAYER_EDGE=16     // bas de l'ecran
+};
+
+// un corps pour le passage de collision
+typedef struct
+{
+    int x,y;          // position en fin de tick
+    int dx,dy;        // deplacement pendant le tick
+    int w,h;
+    const Mask *mask; // NULL: la boite suffit
+    int layer;
+    int collides;     // couches avec lesquelles il interagit
+    int id;           // indice de l'entite chez l'appelant
+} Body;
+
+typedef struct
+{
+    int a,b;  // indices des corps, a a la plus petite couche
+    float t;  // instant du premier contact dans le tick
+} Hit;
+
+static inline void body_set(Body *b,int x,int y,int dx,int dy,int w,int h,const Mask *mask,int layer,int collides,int id)
+{
+    b->x=x;
+    b->y=y;
+    b->dx=dx;
+    b->dy=dy;
+    b->w=w;
+    b->h=h;
+    b->mask=mask;
+    b->layer=layer;
+    b->collides=collides;
+    b->id=id;
+}
+
+// test balaye d'une seule paire, pour qui sait deja quelles paires tester
+int body_contact(const Body *a,const Body *b,float *t);
+
+// un seul passage pour tout le tick: tri grossier sur les trajets, puis test balaye
+// seulement pour les couches qui interagissent; renvoie le nombre de contacts ecrits
+int collide_pass(Broadphase *bp,const Body *bodies,int n,Bp_pair *pairs,int max_pairs,Hit *hits,int max_hits);
+
+#endif
@@ -0,0 +1,35 @@
+#include "events.h"
+
+void events_clear(Event_buffer *b)
+{
+    b->count=0;
+    b->dropped=0;
+}
+
+void event_push(Event_buffer *b,int type,int layer,int id,int x,int y,int value)
+{
+    Event *e;
+    if (b->count>=EVENTS_MAX)
+    {
+        b->dropped+=1;
+        return;
+    }
+    e=&b->ev[b->count++];
+    e->type=type;
+    e->layer=layer;
+    e->id=id;
+    e->x=x;
+    e->y=y;
+    e->value=value;
+}
+
+int events_count(const Event_buffer *b,int type)
+{
+    int i,n=0;
+    for (i=0;i<b->count;i++)
+    {
+        if (b->ev[i].type==type)
+        {n++;}
+    }
+    return n;
+}
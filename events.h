@@ -0,0 +1,37 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+// ce qui s'est passe pendant le tick; le son, l'affichage et l'etat du joueur
+// lisent le tampon chacun a leur tour, hors de la boucle de collision
+enum
+{
+    EVENT_HIT,      // le tir du joueur touche un ennemi
+    EVENT_DAMAGE,   // le joueur perd value coeurs
+    EVENT_SPAWN,    // apparition: tir du joueur, salve (value bals)
+    EVENT_DESPAWN,  // disparition d'une entite (bal qui touche, ennemi abattu)
+    EVENT_PICKUP    // le joueur gagne value coeurs
+};
+
+typedef struct
+{
+    int type;
+    int layer;  // couche de l'entite concernee (LAYER_*)
+    int id;     // indice de l'entite au moment de l'evenement
+    int x,y;    // position a l'ecran
+    int value;
+} Event;
+
+#define EVENTS_MAX 1024
+
+typedef struct
+{
+    Event ev[EVENTS_MAX];
+    int count;
+    int dropped;    // evenements perdus, tampon plein
+} Event_buffer;
+
+void events_clear(Event_buffer *b);
+void event_push(Event_buffer *b,int type,int layer,int id,int x,int y,int value);
+int events_count(const Event_buffer *b,int type);
+
+#endif
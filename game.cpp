@@ -0,0 +1,706 @@
+#include "game.h"
+#include "patterns.h"
+#include "profiler.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <emmintrin.h>
+#include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
+
+// tampons d'un tick: rien ici ne survit au tick, ils restent hors de l'etat
+typedef struct
+{
+    Body *bodies;
+    int max_bodies;
+    Broadphase bp;
+    Bp_pair pairs[1024];
+    Hit hits[256];
+    int landed[256];
+    int rock_hits[256];
+    int toi_body[TOI_BODIES]; // indice dans bodies pendant le tick, -1 si absent
+    const Mask *plane_mask;
+    const Mask *alien_mask;
+    const Mask *fireball_mask;
+    const Mask *rock_mask;
+} Tick_scratch;
+
+static Tick_scratch scratch;
+
+// tirage dans [min,max] avec le generateur de l'etat
+static int game_random(Game *g,int min,int max)
+{
+    return min+(int)(motion_rand(&g->rng)%(unsigned)(max-min+1));
+}
+
+// les bals de l'etat vues comme une pool, pour les noyaux de shots
+static void rocks_view(Game *g,Shot_pool *p)
+{
+    p->x=g->rock_x;
+    p->y=g->rock_y;
+    p->vx=g->rock_vx;
+    p->vy=g->rock_vy;
+    p->count=g->nb_rocks;
+    p->cap=SHOTS_MAX;
+}
+
+// l'ennemi repart en haut avec une nouvelle trajectoire
+static void alien_respawn(Game *g,int i)
+{
+    path_set(&g->paths[i],motion_rand(&g->rng));
+    g->tx[i]=path_start_x(&g->paths[i],g->w*9/10);
+    g->ty[i]=0;
+    toi_remove(&g->toi,TOI_ALIEN(i));
+}
+
+// la trajectoire est connue d'avance: ses contacts possibles sont predits une fois ici
+static void alien_launch(Game *g,int i)
+{
+    Toi_body b;
+    path_launch(&g->paths[i],g->tick);
+    memset(&b,0,sizeof(b));
+    b.x=(float)path_start_x(&g->paths[i],g->w*9/10);
+    b.y=1;
+    path_bounds(&g->paths[i],&b.vy,&b.mx,&b.my);
+    b.w=scratch.alien_mask->w;
+    b.h=scratch.alien_mask->h;
+    b.t0=g->tick;
+    b.layer=LAYER_ALIEN;
+    b.collides=LAYER_FIREBALL|LAYER_EDGE;
+    toi_set(&g->toi,TOI_ALIEN(i),&b);
+}
+
+Game *game_new(int w,int h,const Mask *plane,const Mask *alien,const Mask *fireball,const Mask *rock)
+{
+    Game *g;
+    if (scratch.bodies==NULL)
+    {
+        scratch.max_bodies=SHOTS_MAX+64; // avion, bord, tir, ennemis et bals
+        scratch.bodies=(Body*)malloc(scratch.max_bodies*sizeof(Body));
+        if (scratch.bodies==NULL || bp_init(&scratch.bp,scratch.max_bodies,BP_SCENE_BURST)!=0)
+        {
+            free(scratch.bodies);
+            scratch.bodies=NULL;
+            return NULL;
+        }
+    }
+    scratch.plane_mask=plane;
+    scratch.alien_mask=alien;
+    scratch.fireball_mask=fireball;
+    scratch.rock_mask=rock;
+    g=(Game*)_mm_malloc(sizeof(Game),32);
+    if (g==NULL)
+    {return NULL;}
+    memset(g,0,sizeof(Game));
+    g->w=w;
+    g->h=h;
+    g->xplane=w/2;
+    g->yfireball=h*9/10;
+    g->c=4;
+    g->health=4;
+    toi_init(&g->toi,TOI_BODIES);
+    return g;
+}
+
+void game_delete(Game *g)
+{
+    _mm_free(g);
+}
+
+void game_save(Game *dst,const Game *src)
+{
+    memcpy(dst,src,sizeof(Game));
+}
+
+void game_trim(Game *g)
+{
+    int n=SHOTS_MAX-g->nb_rocks;
+    memset(g->rock_x+g->nb_rocks,0,n*sizeof(int));
+    memset(g->rock_y+g->nb_rocks,0,n*sizeof(int));
+    memset(g->rock_vx+g->nb_rocks,0,n*sizeof(int));
+    memset(g->rock_vy+g->nb_rocks,0,n*sizeof(int));
+    memset(g->toi.heap+g->toi.count,0,(TOI_MAX_EVENTS-g->toi.count)*sizeof(Toi_event));
+}
+
+// xxHash 32 bits: quatre accumulateurs de 32 bits, ~1 octet par cycle
+#define XXH_P1 2654435761u
+#define XXH_P2 2246822519u
+#define XXH_P3 3266489917u
+#define XXH_P4 668265263u
+#define XXH_P5 374761393u
+
+static unsigned rotl(unsigned x,int r)
+{
+    return (x<<r)|(x>>(32-r));
+}
+
+static unsigned xxh32(const void *data,int len,unsigned seed)
+{
+    const unsigned char *p=(const unsigned char*)data,*end=p+len;
+    unsigned h,v1,v2,v3,v4,w[4];
+    if (len>=16)
+    {
+        v1=seed+XXH_P1+XXH_P2;
+        v2=seed+XXH_P2;
+        v3=seed;
+        v4=seed-XXH_P1;
+        do
+        {
+            memcpy(w,p,16);
+            v1=rotl(v1+w[0]*XXH_P2,13)*XXH_P1;
+            v2=rotl(v2+w[1]*XXH_P2,13)*XXH_P1;
+            v3=rotl(v3+w[2]*XXH_P2,13)*XXH_P1;
+            v4=rotl(v4+w[3]*XXH_P2,13)*XXH_P1;
+            p+=16;
+        } while (p<=end-16);
+        h=rotl(v1,1)+rotl(v2,7)+rotl(v3,12)+rotl(v4,18);
+    }
+    else
+    {h=seed+XXH_P5;}
+    h+=(unsigned)len;
+    for (;p+4<=end;p+=4)
+    {
+        memcpy(w,p,4);
+        h=rotl(h+w[0]*XXH_P3,17)*XXH_P4;
+    }
+    for (;p<end;p++)
+    {h=rotl(h+*p*XXH_P5,11)*XXH_P1;}
+    h^=h>>15;
+    h*=XXH_P2;
+    h^=h>>13;
+    h*=XXH_P3;
+    h^=h>>16;
+    return h;
+}
+
+// tout ce qui precede la file des contacts, puis les bals vivantes
+unsigned game_hash(const Game *g)
+{
+    unsigned h=xxh32(g,offsetof(Game,toi),0);
+    h=xxh32(&g->nb_rocks,sizeof(int),h);
+    h=xxh32(g->rock_x,g->nb_rocks*sizeof(int),h);
+    h=xxh32(g->rock_y,g->nb_rocks*sizeof(int),h);
+    h=xxh32(g->rock_vx,g->nb_rocks*sizeof(int),h);
+    h=xxh32(g->rock_vy,g->nb_rocks*sizeof(int),h);
+    return h;
+}
+
+typedef struct
+{
+    const char *name;
+    int offset;
+} Game_field;
+
+#define GAME_FIELD(n) {#n,(int)offsetof(Game,n)}
+
+static const Game_field game_fields[]=
+{
+    GAME_FIELD(w),GAME_FIELD(h),GAME_FIELD(xplane),GAME_FIELD(xplane_sub),GAME_FIELD(xplane_old),
+    GAME_FIELD(xfireball),GAME_FIELD(yfireball),GAME_FIELD(yfireball_old),GAME_FIELD(b),GAME_FIELD(c),
+    GAME_FIELD(reload),GAME_FIELD(health),GAME_FIELD(k),GAME_FIELD(verif),GAME_FIELD(volley),
+    GAME_FIELD(compteur),GAME_FIELD(tick),GAME_FIELD(seed),GAME_FIELD(rng),GAME_FIELD(nb_rocks)
+};
+
+static void diff_line(FILE *f,int *n,int max_lines,const char *name,int i,long long a,long long b)
+{
+    char label[32];
+    if (a==b)
+    {return;}
+    if (*n<max_lines)
+    {
+        if (i<0)
+        {sprintf(label,"%s",name);}
+        else
+        {sprintf(label,"%s[%d]",name,i);}
+        fprintf(f,"  %-16s %12lld %12lld\n",label,a,b);
+    }
+    *n+=1;
+}
+
+int game_diff(FILE *f,const Game *a,const Game *b,int max_lines)
+{
+    int i,n=0,nb;
+    unsigned j;
+    for (j=0;j<sizeof(game_fields)/sizeof(game_fields[0]);j++)
+    {
+        diff_line(f,&n,max_lines,game_fields[j].name,-1,*(const int*)((const char*)a+game_fields[j].offset),
+                  *(const int*)((const char*)b+game_fields[j].offset));
+    }
+    for (i=0;i<NB_ALIENS;i++)
+    {
+        diff_line(f,&n,max_lines,"path_t0",i,a->paths[i].t0,b->paths[i].t0);
+        diff_line(f,&n,max_lines,"path_seed",i,a->paths[i].seed,b->paths[i].seed);
+        diff_line(f,&n,max_lines,"tx",i,a->tx[i],b->tx[i]);
+        diff_line(f,&n,max_lines,"ty",i,a->ty[i],b->ty[i]);
+        diff_line(f,&n,max_lines,"tx_old",i,a->tx_old[i],b->tx_old[i]);
+        diff_line(f,&n,max_lines,"ty_old",i,a->ty_old[i],b->ty_old[i]);
+    }
+    nb=a->nb_rocks<b->nb_rocks ? a->nb_rocks : b->nb_rocks;
+    for (i=0;i<nb;i++)
+    {
+        diff_line(f,&n,max_lines,"rock_x",i,a->rock_x[i],b->rock_x[i]);
+        diff_line(f,&n,max_lines,"rock_y",i,a->rock_y[i],b->rock_y[i]);
+        diff_line(f,&n,max_lines,"rock_vx",i,a->rock_vx[i],b->rock_vx[i]);
+        diff_line(f,&n,max_lines,"rock_vy",i,a->rock_vy[i],b->rock_vy[i]);
+    }
+    if (n>max_lines)
+    {fprintf(f,"  ... %d champs de plus\n",n-max_lines);}
+    return n;
+}
+
+void game_reset(Game *g,unsigned seed)
+{
+    int i;
+    Toi_body edge;
+    g->xplane=g->w/2;
+    g->xplane_sub=0;
+    g->xplane_old=g->xplane;
+    g->xfireball=0;
+    g->yfireball=g->h*9/10;
+    g->yfireball_old=g->yfireball;
+    g->b=0;
+    g->c=4;
+    g->reload=0;
+    g->health=4;
+    g->tick=0;
+    g->seed=seed;
+    g->rng=g->seed;
+    toi_clear(&g->toi);
+    memset(&edge,0,sizeof(edge));
+    edge.x=-200;
+    edge.y=(float)(g->h*9/10+scratch.alien_mask->h-1);
+    edge.w=g->w+400;
+    edge.h=g->h;
+    edge.layer=LAYER_EDGE;
+    edge.collides=LAYER_ALIEN;
+    toi_set(&g->toi,TOI_EDGE,&edge);
+    for (i=0;i<NB_ALIENS;i++)
+    {alien_respawn(g,i);}
+    g->k=0;
+    g->verif=0;
+    g->volley=0;
+    g->nb_rocks=0;
+    g->compteur=0;
+}
+
+void game_tick(Game *g,const Input_snapshot *in,Frame *f)
+{
+    int x=g->w,y=g->h;
+    int i,j,p,k2,r,nb_bodies,nb_hits,nb_due,nb_rock_hits;
+    Shot_pool rocks;
+    Event_buffer *events=&f->events;
+    long long t0=prof_now_ns();
+    events_clear(events);
+    rocks_view(g,&rocks);
+    f->effects=0;
+    f->held=0;
+    for (k2=0;k2<KEY_NB;k2++)
+    {
+        if (input_held(in,k2))
+        {f->held|=KEY_BIT(k2);}
+    }
+    f->fired=0;
+    f->flying=0;
+    f->fireball_erase=0;
+    if ((GAME_MS(g)%850)==0 && g->k<36 ) // le delai de l'apparition des ennemis et condition sur le nombre d'ennemis envoyes
+    {
+        if ((GAME_MS(g)/850)<=1)
+        {r=2;}
+        else
+        {r=game_random(g,1,2);}
+        for (i=g->k;i<g->k+r;i++)
+        {
+            if (!path_launched(&g->paths[i]))
+            {alien_launch(g,i);}
+        }
+        g->k+=r;
+    }
+    else if(g->k>=36)
+    {g->k=0;}
+
+    // chaque appui compte a partir de l'instant ou il est arrive dans le tick
+    g->xplane_old=g->xplane;
+    if (input_held(in,KEY_LEFT) && g->xplane>0)
+    {g->xplane_sub-=(int)(512*input_held_fraction(in,KEY_LEFT));}
+    else if(input_held(in,KEY_RIGHT) && g->xplane<x*9/10)
+    {g->xplane_sub+=(int)(512*input_held_fraction(in,KEY_RIGHT));}
+    g->xplane+=g->xplane_sub/256;
+    g->xplane_sub%=256;
+    if (g->xplane!=g->xplane_old)
+    {f->effects|=KEY_BIT(g->xplane<g->xplane_old ? KEY_LEFT : KEY_RIGHT);}
+    f->xplane=g->xplane;
+
+    g->yfireball_old=g->yfireball;
+    if (input_held(in,KEY_LCTRL) && g->b==0 && g->c!=0&& (GAME_MS(g)/500-g->reload)!=0) //controler fireball
+    {
+        g->c-=1;
+        g->reload=GAME_MS(g)/500;
+        f->fired=1;
+        f->fire_x=g->xplane;
+        f->fire_y=g->yfireball-40;
+        event_push(events,EVENT_SPAWN,LAYER_FIREBALL,0,g->xplane,g->yfireball,1);
+        g->xfireball=g->xplane;
+        g->yfireball-=(int)(3*input_press_age(in,KEY_LCTRL)+0.5f); // parti a l'appui
+        g->b=1;
+        f->effects|=KEY_BIT(KEY_LCTRL);
+    }
+    if (g->b==1 && g->yfireball>0)
+    {
+        g->yfireball-=3;
+        f->flying=1;
+        f->xfireball=g->xfireball;
+        f->yfireball=g->yfireball;
+        if (g->yfireball>=0 && g->yfireball<=10)
+        {
+            g->b=0;
+            g->yfireball=y*9/10;
+        }
+        else if( g->yfireball<=(y*90/100)-40)
+        {f->fireball_erase=1;}
+    }
+
+    // la position se lit sur la trajectoire: rien a calculer pour les ennemis en attente
+    for (j=0;j<NB_ALIENS;j++)
+    {
+        g->tx_old[j]=g->tx[j];
+        g->ty_old[j]=g->ty[j];
+        f->alien_moved[j]=0;
+        if (path_launched(&g->paths[j]) && g->ty[j]<y*9/10)
+        {
+            path_at(&g->paths[j],g->tick,x*9/10,&g->tx[j],&g->ty[j]);
+            if (g->tx[j]!=g->tx_old[j] || g->ty[j]!=g->ty_old[j])
+            {
+                f->alien_moved[j]=1;
+                f->tx[j]=g->tx[j];
+                f->ty[j]=g->ty[j];
+                f->tx_old[j]=g->tx_old[j];
+                f->ty_old[j]=g->ty_old[j];
+            }
+        }
+    }
+    for (i=0;i<NB_ALIENS;i++)
+    {
+        if (g->ty[i]<=y*9/10 && g->ty[i]>y/40 && g->verif==0) //positionner les bals des ennemis
+        {
+            // la salve est decrite en donnees et ecrite d'un coup dans la pool
+            r=pattern_emit(&rocks,pattern_next(g->volley),g->tx[i],g->ty[i],g->xplane-40,y*9/10,g->volley);
+            event_push(events,EVENT_SPAWN,LAYER_ROCK,g->volley,g->tx[i],g->ty[i],r);
+            g->volley+=1;
+            g->verif=1;
+        }
+    }
+    // avancer, retirer et tasser toutes les bals en un seul passage
+    shots_update(&rocks,FX(-200),FX(x+200),FX(-200),FX(y*9/10),scratch.landed,256);
+
+    // les bals passent par le passage balaye: chaque corps porte sa couche et les couches
+    // qu'il touche, une nouvelle interaction n'est qu'un bit de plus dans un masque
+    nb_bodies=0;
+    body_set(&scratch.bodies[nb_bodies++],g->xplane,y*90/100,g->xplane-g->xplane_old,0,scratch.plane_mask->w,scratch.plane_mask->h,
+             scratch.plane_mask,LAYER_PLANE,LAYER_ROCK,0);
+    for (i=0;i<rocks.count && nb_bodies<scratch.max_bodies-TOI_BODIES;i++)
+    {
+        body_set(&scratch.bodies[nb_bodies++],FX_INT(rocks.x[i])+50,FX_INT(rocks.y[i])+80,
+                 FX_INT(rocks.x[i])-FX_INT(rocks.x[i]-rocks.vx[i]),FX_INT(rocks.y[i])-FX_INT(rocks.y[i]-rocks.vy[i]),
+                 scratch.rock_mask->w,scratch.rock_mask->h,scratch.rock_mask,LAYER_ROCK,LAYER_PLANE,i);
+    }
+    nb_hits=rocks.count>0 ? collide_pass(&scratch.bp,scratch.bodies,nb_bodies,scratch.pairs,1024,scratch.hits,256) : 0;
+
+    // le tir, les ennemis et le bas de l'ecran suivent des trajectoires connues:
+    // une paire n'est testee qu'au tick ou la file dit qu'elle peut se toucher
+    if (f->fired || (g->b==1 && g->toi.bodies[TOI_FIREBALL].layer==0))
+    {
+        Toi_body tb;
+        memset(&tb,0,sizeof(tb));
+        tb.x=(float)g->xfireball;
+        tb.y=(float)g->yfireball;
+        tb.vy=-3;
+        tb.my=1;
+        tb.w=scratch.fireball_mask->w;
+        tb.h=scratch.fireball_mask->h;
+        tb.t0=g->tick;
+        tb.layer=LAYER_FIREBALL;
+        tb.collides=LAYER_ALIEN;
+        toi_set(&g->toi,TOI_FIREBALL,&tb);
+    }
+    else if (g->b==0)
+    {toi_remove(&g->toi,TOI_FIREBALL);}
+    scratch.toi_body[TOI_EDGE]=nb_bodies;
+    body_set(&scratch.bodies[nb_bodies++],-200,y*9/10+scratch.alien_mask->h-1,0,0,x+400,y,
+             NULL,LAYER_EDGE,LAYER_ALIEN,0); // un ennemi qui atteint y*9/10 le touche
+    scratch.toi_body[TOI_FIREBALL]=-1;
+    if (g->b==1)
+    {
+        scratch.toi_body[TOI_FIREBALL]=nb_bodies;
+        body_set(&scratch.bodies[nb_bodies++],g->xfireball,g->yfireball,0,g->yfireball-g->yfireball_old,
+                 scratch.fireball_mask->w,scratch.fireball_mask->h,scratch.fireball_mask,LAYER_FIREBALL,LAYER_ALIEN,0);
+    }
+    for (j=0;j<NB_ALIENS;j++)
+    {
+        scratch.toi_body[TOI_ALIEN(j)]=-1;
+        if (path_launched(&g->paths[j])) // seulement les ennemis lances
+        {
+            scratch.toi_body[TOI_ALIEN(j)]=nb_bodies;
+            body_set(&scratch.bodies[nb_bodies++],g->tx[j],g->ty[j],g->tx[j]-g->tx_old[j],g->ty[j]-g->ty_old[j],scratch.alien_mask->w,scratch.alien_mask->h,
+                     scratch.alien_mask,LAYER_ALIEN,LAYER_FIREBALL|LAYER_EDGE,j);
+        }
+    }
+    nb_due=toi_due(&g->toi,g->tick,scratch.pairs,1024);
+    for (p=0;p<nb_due;p++)
+    {
+        Hit h;
+        h.a=scratch.toi_body[scratch.pairs[p].a];
+        h.b=scratch.toi_body[scratch.pairs[p].b];
+        if (h.a>=0 && h.b>=0 && nb_hits<256)
+        {
+            if (scratch.bodies[h.a].layer>scratch.bodies[h.b].layer)
+            {
+                k2=h.a;
+                h.a=h.b;
+                h.b=k2;
+            }
+            if (body_contact(&scratch.bodies[h.a],&scratch.bodies[h.b],&h.t))
+            {scratch.hits[nb_hits++]=h;}
+        }
+        toi_repredict(&g->toi,scratch.pairs[p].a,scratch.pairs[p].b,g->tick);
+    }
+    // la boucle de collision ne fait que changer l'etat et noter ce qui s'est passe
+    for (p=0;p<nb_hits;p++)
+    {
+        Body *A=&scratch.bodies[scratch.hits[p].a];
+        Body *B=&scratch.bodies[scratch.hits[p].b];
+        j=B->id;
+        if (A->layer==LAYER_FIREBALL && g->b==1) // le tir touche un ennemi
+        {
+            event_push(events,EVENT_HIT,LAYER_ALIEN,j,g->tx[j]+60,g->ty[j],1);
+            event_push(events,EVENT_DESPAWN,LAYER_FIREBALL,0,g->xfireball,g->yfireball,0);
+            g->b=0;
+            g->yfireball=y*9/10;
+            alien_respawn(g,j);
+        }
+        else if (A->layer==LAYER_ALIEN && g->ty[A->id]>=y*9/10) // l'ennemi est passe
+        {
+            j=A->id;
+            event_push(events,EVENT_DAMAGE,LAYER_ALIEN,j,g->tx[j]+60,g->ty[j],1);
+            alien_respawn(g,j);
+        }
+        else if (A->layer==LAYER_PLANE) // une bal touche l'avion
+        {
+            event_push(events,EVENT_DAMAGE,LAYER_ROCK,j,B->x,B->y,1);
+            event_push(events,EVENT_DESPAWN,LAYER_ROCK,j,B->x,B->y,0);
+        }
+    }
+    // les bals qui ont touche, indices tries en decroissant pour retirer sans decaler les autres
+    nb_rock_hits=0;
+    for (p=0;p<events->count;p++)
+    {
+        if (events->ev[p].type==EVENT_DESPAWN && events->ev[p].layer==LAYER_ROCK)
+        {
+            for (k2=nb_rock_hits;k2>0 && scratch.rock_hits[k2-1]<events->ev[p].id;k2--)
+            {scratch.rock_hits[k2]=scratch.rock_hits[k2-1];}
+            scratch.rock_hits[k2]=events->ev[p].id;
+            nb_rock_hits+=1;
+        }
+    }
+    for (p=0;p<nb_rock_hits;p++)
+    {shots_remove(&rocks,scratch.rock_hits[p]);}
+    if (rocks.count==0)
+    {g->verif=0;}
+
+    g->compteur+=1;
+    if (g->compteur==100)
+    {g->compteur=0;}
+    if ((GAME_MS(g)%400)==0 && g->c<4)
+    {g->c+=1;} // augmenter le nb d'amo au cours du temps
+    if ((GAME_MS(g)%15000)==0 && g->health<4)
+    {event_push(events,EVENT_PICKUP,LAYER_PLANE,0,g->xplane,y*90/100,1);} //augmenter le nb de coeur de l'avion
+    for (p=0;p<events->count;p++) // coeurs perdus et gagnes pendant le tick
+    {
+        if (events->ev[p].type==EVENT_DAMAGE)
+        {g->health-=events->ev[p].value;}
+        else if (events->ev[p].type==EVENT_PICKUP)
+        {g->health+=events->ev[p].value;}
+    }
+    if (g->health<0)
+    {g->health=0;}
+
+    g->nb_rocks=rocks.count;
+    g->tick+=1;
+
+    // la copie pour le rendu
+    f->nb_rocks=rocks.count;
+    memcpy(f->rock_x,rocks.x,rocks.count*sizeof(int));
+    memcpy(f->rock_y,rocks.y,rocks.count*sizeof(int));
+    memcpy(f->rock_vx,rocks.vx,rocks.count*sizeof(int));
+    f->c=g->c;
+    f->health=g->health;
+    f->over=g->health==0;
+    prof_add(PROF_SIM_TICK,prof_now_ns()-t0);
+}
+
+void game_populate(Game *g,int aliens,int rocks)
+{
+    int i;
+    for (i=0;i<aliens && i<NB_ALIENS;i++)
+    {
+        if (!path_launched(&g->paths[i]))
+        {alien_launch(g,i);}
+    }
+    if (rocks>SHOTS_MAX)
+    {rocks=SHOTS_MAX;}
+    for (i=g->nb_rocks;i<rocks;i++)
+    {
+        g->rock_x[i]=FX(game_random(g,0,g->w-100));
+        g->rock_y[i]=FX(game_random(g,0,g->h*8/10));
+        g->rock_vx[i]=game_random(g,-FX(1)/2,FX(1)/2);
+        g->rock_vy[i]=game_random(g,FX(1)/4,FX(1));
+    }
+    if (rocks>g->nb_rocks)
+    {
+        g->nb_rocks=rocks;
+        g->verif=1; // une salve est deja en l'air
+    }
+}
+
+// une sauvegarde pleine (toutes les bals) dans un autre bloc puis retour, n fois
+void game_bench_save(FILE *f,int n)
+{
+    Mask box;
+    Game *g,*copy;
+    long long t_save=0,t_load=0,t0;
+    int i,same=1;
+    mask_box(&box,100,100);
+    g=game_new(1280,960,&box,&box,&box,&box);
+    copy=game_new(1280,960,&box,&box,&box,&box);
+    if (g==NULL || copy==NULL)
+    {
+        fprintf(f,"snapshot bench: allocation impossible\n");
+        return;
+    }
+    game_reset(g,1);
+    for (i=0;i<SHOTS_MAX;i++)
+    {
+        g->rock_x[i]=FX(i%1280);
+        g->rock_y[i]=FX(i%860);
+        g->rock_vx[i]=i%7-3;
+        g->rock_vy[i]=FX(1);
+    }
+    g->nb_rocks=SHOTS_MAX;
+    for (i=0;i<n;i++)
+    {
+        t0=prof_now_ns();
+        game_save(copy,g);
+        t_save+=prof_now_ns()-t0;
+        g->tick+=1;
+        t0=prof_now_ns();
+        game_save(g,copy);
+        t_load+=prof_now_ns()-t0;
+        if (g->tick!=copy->tick)
+        {same=0;}
+    }
+    if (memcmp(g,copy,sizeof(Game))!=0)
+    {same=0;}
+    fprintf(f,"snapshot bench: etat de %u Ko (%d bals au plus), %d fois\n",(unsigned)(sizeof(Game)/1024),SHOTS_MAX,n);
+    fprintf(f,"  sauvegarde   %9.1f us\n",t_save/1000.0/n);
+    fprintf(f,"  restauration %9.1f us  %s\n",t_load/1000.0/n,same ? "etat identique" : "ETAT DIFFERENT");
+    game_delete(g);
+    game_delete(copy);
+    mask_free(&box);
+}
+
+int frame_init(Frame *f,int cap)
+{
+    memset(f,0,sizeof(Frame));
+    f->rock_x=(int*)malloc(cap*sizeof(int));
+    f->rock_y=(int*)malloc(cap*sizeof(int));
+    f->rock_vx=(int*)malloc(cap*sizeof(int));
+    if (f->rock_x==NULL || f->rock_y==NULL || f->rock_vx==NULL)
+    {
+        frame_free(f);
+        return -1;
+    }
+    return 0;
+}
+
+void frame_free(Frame *f)
+{
+    free(f->rock_x);
+    free(f->rock_y);
+    free(f->rock_vx);
+    f->rock_x=f->rock_y=f->rock_vx=NULL;
+}
+
+// ------------------------------------------------------------------ thread de simulation
+
+static SDL_Thread *sim_thread=NULL;
+static SDL_sem *sim_go=NULL;
+static SDL_sem *sim_done=NULL;
+static int sim_quit=0;
+static Game *sim_game;
+static const Input_snapshot *sim_in;
+static Frame *sim_frame;
+
+static int SDLCALL sim_loop(void *data)
+{
+    for (;;)
+    {
+        SDL_SemWait(sim_go);
+        if (__atomic_load_n(&sim_quit,__ATOMIC_ACQUIRE))
+        {break;}
+        game_tick(sim_game,sim_in,sim_frame);
+        SDL_SemPost(sim_done);
+    }
+    return 0;
+}
+
+int sim_start()
+{
+    sim_stop();
+    sim_quit=0;
+    sim_go=SDL_CreateSemaphore(0);
+    sim_done=SDL_CreateSemaphore(0);
+    if (sim_go!=NULL && sim_done!=NULL)
+    {sim_thread=SDL_CreateThread(sim_loop,NULL);}
+    if (sim_thread==NULL)
+    {
+        sim_stop();
+        return -1;
+    }
+    return 0;
+}
+
+void sim_begin(Game *g,const Input_snapshot *in,Frame *f)
+{
+    if (sim_thread==NULL)
+    {
+        game_tick(g,in,f);
+        return;
+    }
+    // le semaphore publie ces trois pointeurs au thread de simulation
+    sim_game=g;
+    sim_in=in;
+    sim_frame=f;
+    SDL_SemPost(sim_go);
+}
+
+void sim_end()
+{
+    if (sim_thread!=NULL)
+    {SDL_SemWait(sim_done);}
+}
+
+void sim_stop()
+{
+    if (sim_thread!=NULL)
+    {
+        __atomic_store_n(&sim_quit,1,__ATOMIC_RELEASE);
+        SDL_SemPost(sim_go);
+        SDL_WaitThread(sim_thread,NULL);
+        sim_thread=NULL;
+    }
+    if (sim_go!=NULL)
+    {SDL_DestroySemaphore(sim_go);}
+    if (sim_done!=NULL)
+    {SDL_DestroySemaphore(sim_done);}
+    sim_go=sim_done=NULL;
+}
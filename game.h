@@ -0,0 +1,113 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "broadphase.h"
+#include "collision.h"
+#include "events.h"
+#include "input.h"
+#include "motion.h"
+#include "shots.h"
+#include "toi.h"
+
+#define NB_ALIENS 40
+
+// la simulation avance d'un pas fixe: son horloge est le numero de tick,
+// jamais l'heure de la machine, pour qu'une partie se rejoue a l'identique
+#define GAME_TICK_MS 10
+#define GAME_MS(g) ((g)->tick*GAME_TICK_MS)
+
+// corps suivis par la file des contacts
+#define TOI_EDGE 0
+#define TOI_FIREBALL 1
+#define TOI_ALIEN(j) (2+(j))
+#define TOI_BODIES TOI_ALIEN(NB_ALIENS)
+
+// etat de la simulation: seul le thread de simulation l'ecrit pendant une partie.
+// Un seul bloc sans pointeur: les bals vivent dedans, une sauvegarde est un memcpy
+// (game_save) et le bloc peut etre deplace ou ecrit tel quel
+typedef struct
+{
+    int w,h;            // taille de la fenetre
+    int xplane;
+    int xplane_sub;     // 1/256 de pixel, pour les appuis plus courts qu'un tick
+    int xplane_old;
+    int xfireball;
+    int yfireball;
+    int yfireball_old;
+    int b;              // le tir est en vol
+    int c;              // munitions
+    int reload;
+    int health;
+    int k;              // prochain ennemi a lancer
+    int verif;          // une salve est en l'air
+    int volley;         // numero de salve, choisit le motif et sa phase
+    int compteur;
+    int tick;           // ticks depuis le debut de la partie
+    unsigned seed;      // graine de la partie
+    unsigned rng;       // etat du generateur du jeu
+    Path paths[NB_ALIENS];
+    int tx[NB_ALIENS];  // position au tick courant, tiree de paths
+    int ty[NB_ALIENS];
+    int tx_old[NB_ALIENS];
+    int ty_old[NB_ALIENS];
+    Toi toi;            // tir, ennemis et bas de l'ecran: testes seulement quand ils peuvent se toucher
+    int nb_rocks;       // bals des ennemis, en SoA 16.16 comme une Shot_pool
+    int rock_x[SHOTS_MAX] __attribute__((aligned(32)));
+    int rock_y[SHOTS_MAX] __attribute__((aligned(32)));
+    int rock_vx[SHOTS_MAX] __attribute__((aligned(32)));
+    int rock_vy[SHOTS_MAX] __attribute__((aligned(32)));
+} Game;
+
+// ce que le rendu lit: copie de la fin d'un tick, figee jusqu'a l'echange suivant
+typedef struct
+{
+    int xplane;
+    int fired;          // le tir part pendant ce tick, dessine au depart
+    int fire_x,fire_y;
+    int flying;         // le tir est en vol
+    int xfireball,yfireball;
+    int fireball_erase;
+    int alien_moved[NB_ALIENS];
+    int tx[NB_ALIENS];
+    int ty[NB_ALIENS];
+    int tx_old[NB_ALIENS];  // ou l'ennemi a ete dessine au tick d'avant
+    int ty_old[NB_ALIENS];
+    int nb_rocks;
+    int *rock_x;        // 16.16, copies de la pool
+    int *rock_y;
+    int *rock_vx;
+    int c;
+    int health;
+    unsigned effects;   // touches dont l'effet est visible dans ce tick (KEY_BIT)
+    unsigned held;      // touches enfoncees ou tapees pendant ce tick (KEY_BIT)
+    int over;           // plus de coeurs
+    Event_buffer events;
+} Frame;
+
+// bloc aligne pour les noyaux SIMD; les masques et les tampons du tick sont partages
+// par tous les etats (un seul tick a la fois)
+Game *game_new(int w,int h,const Mask *plane,const Mask *alien,const Mask *fireball,const Mask *rock);
+void game_delete(Game *g);
+void game_reset(Game *g,unsigned seed);   // nouvelle partie: tout l'etat ne depend que de la graine
+void game_save(Game *dst,const Game *src);  // sauvegarde et restauration: un seul memcpy
+void game_trim(Game *g);    // met a zero ce qui n'est plus lu (bals retirees, predictions depilees)
+// empreinte de l'etat de jeu (pas de la file des contacts, qui n'est qu'un index):
+// deux simulations qui ont la meme a chaque tick ont fait la meme partie
+unsigned game_hash(const Game *g);
+int game_diff(FILE *f,const Game *a,const Game *b,int max_lines); // champs qui different, leur nombre
+void game_bench_save(FILE *f,int n);
+void game_tick(Game *g,const Input_snapshot *in,Frame *f);
+// scenes de mesure: jusqu'a aliens ennemis lances tout de suite, bals ajoutees jusqu'a rocks
+void game_populate(Game *g,int aliens,int rocks);
+
+int frame_init(Frame *f,int cap);
+void frame_free(Frame *f);
+
+// thread de simulation: le tick N+1 est calcule pendant que le thread
+// de la fenetre dessine le tick N; sans thread, sim_begin calcule tout de suite
+int sim_start();
+void sim_begin(Game *g,const Input_snapshot *in,Frame *f);
+void sim_end();
+void sim_stop();
+
+#endif
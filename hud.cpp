@@ -0,0 +1,112 @@
+#include "hud.h"
+
+void back_remover1(int x,int y)
+{
+     MLV_draw_filled_circle( x+15, y+14, 15, MLV_COLOR_BLACK );
+}
+void aff(MLV_Image *amo,MLV_Image *heal,int c,int health,int h) // affichage  le nombre d'amo et des coueurs restants
+{
+                       int P=(h*9/10)-250;
+                          if(c==0)
+                      {
+                      back_remover1(5,P);
+                      back_remover1(5,P+40);
+                      back_remover1(5,P+80);
+                      back_remover1(5,P+120);
+                      }
+                      if (c==1)
+                      {MLV_draw_image(amo,5,P+120);
+                      back_remover1(5,P+80);
+                      
+					  }
+                      if(c==2)
+                      {
+                      	MLV_draw_image(amo,5,P+120);
+                      	MLV_draw_image(amo,5,P+80);
+                      	back_remover1(5,P+40);
+					  }
+					  if(c==3)
+					  {
+					  	  MLV_draw_image(amo,5,P+120);
+					  	  MLV_draw_image(amo,5,P+80); 
+                          MLV_draw_image(amo,5,P+40);
+                          back_remover1(5,P);
+					  }
+					  if(c==4)
+					  {
+					  	MLV_draw_image(amo,5,P);
+					  	MLV_draw_image(amo,5,P+40);
+					  	MLV_draw_image(amo,5,P+80);
+					  	MLV_draw_image(amo,5,P+120);
+					  }
+					  //---------------------------------------//
+					  P-=50;
+                      if(health==0)
+                      {
+                      back_remover1(5,P-40);
+                      back_remover1(5,P-80);
+                      back_remover1(5,P-120);
+                      back_remover1(5,P-160);
+                      }
+                      if (health==1)
+                      {MLV_draw_image(heal,5,P-160);
+                      back_remover1(5,P-120);
+                      
+					  }
+                      if(health==2)
+                      {
+                      	MLV_draw_image(heal,5,P-160);
+                      	MLV_draw_image(amo,5,P-120);
+                      	back_remover1(5,P-120);
+					  }
+					  if(health==3)
+					  {
+					  	  MLV_draw_image(heal,5,P-160);
+					  	  MLV_draw_image(heal,5,P-120); 
+                          MLV_draw_image(heal,5,P-80);
+                          back_remover1(5,P-40);
+					  }
+					  if(health==4)
+					  {
+					  	MLV_draw_image(heal,5,P-160);
+					  	MLV_draw_image(heal,5,P-120);
+					  	MLV_draw_image(heal,5,P-80);
+					  	MLV_draw_image(heal,5,P-40);
+					  }
+}
+
+// memes cases que aff: les munitions se remplissent par le bas, les coeurs par le haut
+static int ammo_y(int h,int i)
+{
+    return (h*9/10)-130-40*i;
+}
+
+static int heal_y(int h,int i)
+{
+    return (h*9/10)-460+40*i;
+}
+
+void hud_reset(Hud *hud,int h)
+{
+    hud->c=0;
+    hud->health=0;
+    hud->h=h;
+}
+
+void hud_draw(Hud *hud,MLV_Image *amo,MLV_Image *heal,int c,int health)
+{
+    int i;
+    for (i=0;i<HUD_SLOTS;i++)
+    {
+        if (i<c)
+        {MLV_draw_image(amo,5,ammo_y(hud->h,i));}
+        else if (i<hud->c)
+        {back_remover1(5,ammo_y(hud->h,i));}
+        if (i<health)
+        {MLV_draw_image(heal,5,heal_y(hud->h,i));}
+        else if (i<hud->health)
+        {back_remover1(5,heal_y(hud->h,i));}
+    }
+    hud->c=c;
+    hud->health=health;
+}
@@ -0,0 +1,24 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <MLV/MLV_all.h>
+
+// munitions et coeurs a gauche de l'ecran: HUD_SLOTS cases de 28x28 chacun
+#define HUD_SLOTS 4
+
+// les sprites passent sur les cases et les effacent en partant: les icones pleines sont
+// recollees a chaque image, une case qui se vide n'est effacee qu'une fois
+typedef struct
+{
+    int c,health;   // ce qui est a l'ecran
+    int h;          // hauteur de la fenetre
+} Hud;
+
+void hud_reset(Hud *hud,int h); // l'ecran vient d'etre efface
+void hud_draw(Hud *hud,MLV_Image *amo,MLV_Image *heal,int c,int health);
+
+// l'ancien affichage, qui redessine ou efface toutes les cases a chaque appel;
+// garde pour le micro-banc
+void aff(MLV_Image *amo,MLV_Image *heal,int c,int health,int h);
+
+#endif
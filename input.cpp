@@ -0,0 +1,241 @@
+#include "input.h"
+#include "profiler.h"
+
+#include <string.h>
+#include <SDL/SDL_thread.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>
+#endif
+
+// file circulaire un producteur / un consommateur, sans verrou:
+// le thread de lecture n'ecrit que ring_head, le jeu que ring_tail
+#define RING_SIZE 256
+
+static Input_event ring[RING_SIZE];
+static unsigned ring_head=0;
+static unsigned ring_tail=0;
+static SDL_Thread *reader=NULL;
+static int reader_quit=0;
+
+static int ring_push(long long time,int key,int down)
+{
+    unsigned head=__atomic_load_n(&ring_head,__ATOMIC_RELAXED);
+    if (head-__atomic_load_n(&ring_tail,__ATOMIC_ACQUIRE)==RING_SIZE)
+    {return 0;}
+    ring[head%RING_SIZE].time=time;
+    ring[head%RING_SIZE].key=(unsigned char)key;
+    ring[head%RING_SIZE].down=(unsigned char)down;
+    __atomic_store_n(&ring_head,head+1,__ATOMIC_RELEASE);
+    return 1;
+}
+
+static int ring_pop(Input_event *ev)
+{
+    unsigned tail=__atomic_load_n(&ring_tail,__ATOMIC_RELAXED);
+    if (tail==__atomic_load_n(&ring_head,__ATOMIC_ACQUIRE))
+    {return 0;}
+    *ev=ring[tail%RING_SIZE];
+    __atomic_store_n(&ring_tail,tail+1,__ATOMIC_RELEASE);
+    return 1;
+}
+
+static int input_key(MLV_Keyboard_button key)
+{
+    switch (key)
+    {
+        case MLV_KEYBOARD_ESCAPE: return KEY_ESCAPE;
+        case MLV_KEYBOARD_TAB: return KEY_TAB;
+        case MLV_KEYBOARD_LEFT: return KEY_LEFT;
+        case MLV_KEYBOARD_RIGHT: return KEY_RIGHT;
+        case MLV_KEYBOARD_LCTRL: return KEY_LCTRL;
+        default: return -1;
+    }
+}
+
+#ifdef _WIN32
+// SDL 1.2 ne peut pomper les messages de la fenetre que depuis le thread qui
+// l'a creee: le thread de lecture interroge donc directement le clavier
+static const int vkeys[KEY_NB]={VK_ESCAPE,VK_TAB,VK_LEFT,VK_RIGHT,VK_LCONTROL};
+
+static int SDLCALL reader_loop(void *data)
+{
+    unsigned state=0,now_state;
+    DWORD pid;
+    long long t;
+    int k;
+    timeBeginPeriod(1);
+    while (!__atomic_load_n(&reader_quit,__ATOMIC_ACQUIRE))
+    {
+          now_state=0;
+          pid=0;
+          GetWindowThreadProcessId(GetForegroundWindow(),&pid);
+          if (pid==GetCurrentProcessId()) // pas de touches quand la fenetre n'a pas le focus
+          {
+              for (k=0;k<KEY_NB;k++)
+              {
+                  if (GetAsyncKeyState(vkeys[k])&0x8000)
+                  {now_state|=KEY_BIT(k);}
+              }
+          }
+          t=prof_now_ns();
+          for (k=0;k<KEY_NB;k++)
+          {
+              // si la file est pleine on retentera au prochain tour
+              if (((now_state^state)&KEY_BIT(k)) && ring_push(t,k,(now_state&KEY_BIT(k))!=0))
+              {state^=KEY_BIT(k);}
+          }
+          Sleep(1);
+    }
+    timeEndPeriod(1);
+    return 0;
+}
+#endif
+
+void input_init(Input_snapshot *in)
+{
+    memset(in,0,sizeof(Input_snapshot));
+    MLV_flush_event_queue();
+    input_stop();
+    ring_head=0;
+    ring_tail=0;
+#ifdef _WIN32
+    reader_quit=0;
+    reader=SDL_CreateThread(reader_loop,NULL);
+#endif
+}
+
+void input_stop()
+{
+    if (reader!=NULL)
+    {
+        __atomic_store_n(&reader_quit,1,__ATOMIC_RELEASE);
+        SDL_WaitThread(reader,NULL);
+        reader=NULL;
+    }
+}
+
+void input_poll(Input_snapshot *in)
+{
+    MLV_Keyboard_button key;
+    MLV_Button_state state;
+    Input_event ev;
+    long long now=prof_now_ns();
+    long long since[KEY_NB];
+    long long t;
+    int k;
+    in->tick_start=in->tick_end!=0 ? in->tick_end : now;
+    in->tick_end=now;
+    in->pressed=0;
+    in->released=0;
+    for (k=0;k<KEY_NB;k++)
+    {
+        in->held_ns[k]=0;
+        since[k]=in->tick_start;
+    }
+    // la file MLV doit etre videe de toute facon: c'est elle qui pompe la fenetre
+    while (MLV_get_event(&key,NULL,NULL,NULL,NULL,NULL,NULL,NULL,&state)!=MLV_NONE)
+    {
+          k=input_key(key);
+          if (k<0 || reader!=NULL)
+          {continue;}
+          // sans thread de lecture on ne connait pas la date d'arrivee: un appui
+          // compte depuis le debut du tick, un relachement jusqu'a la fin
+          ring_push(state==MLV_PRESSED ? in->tick_start : now,k,state==MLV_PRESSED);
+    }
+    while (ring_pop(&ev))
+    {
+          k=ev.key;
+          t=ev.time<in->tick_start ? in->tick_start : (ev.time>now ? now : ev.time);
+          if (ev.down && !(in->down & KEY_BIT(k)))
+          {
+              in->pressed|=KEY_BIT(k);
+              in->press_time[k]=t;
+              in->down|=KEY_BIT(k);
+              since[k]=t;
+          }
+          else if (!ev.down && (in->down & KEY_BIT(k)))
+          {
+              in->released|=KEY_BIT(k);
+              in->release_time[k]=t;
+              in->down&=~KEY_BIT(k);
+              in->held_ns[k]+=t-since[k];
+          }
+    }
+    for (k=0;k<KEY_NB;k++)
+    {
+        if (in->down & KEY_BIT(k))
+        {in->held_ns[k]+=now-since[k];}
+    }
+}
+
+int input_held(const Input_snapshot *in,int key)
+{
+    return ((in->down|in->pressed) & KEY_BIT(key))!=0;
+}
+
+int input_pressed(const Input_snapshot *in,int key)
+{
+    return (in->pressed & KEY_BIT(key))!=0;
+}
+
+float input_held_fraction(const Input_snapshot *in,int key)
+{
+    long long len=in->tick_end-in->tick_start;
+    if (len<=0)
+    {return input_held(in,key) ? 1.0f : 0.0f;}
+    return (float)in->held_ns[key]/len;
+}
+
+float input_press_age(const Input_snapshot *in,int key)
+{
+    long long len=in->tick_end-in->tick_start;
+    if (len<=0 || !input_pressed(in,key))
+    {return 0;}
+    return (float)(in->tick_end-in->press_time[key])/len;
+}
+
+static unsigned char steps(long long part,long long len)
+{
+    long long s;
+    if (len<=0)
+    {return 0;}
+    s=(part*INPUT_STEPS+len/2)/len;
+    return (unsigned char)(s<0 ? 0 : (s>INPUT_STEPS ? INPUT_STEPS : s));
+}
+
+void input_quantize(const Input_snapshot *in,Input_tick *t)
+{
+    long long len=in->tick_end-in->tick_start;
+    int k;
+    memset(t,0,sizeof(Input_tick));
+    t->down=(unsigned char)in->down;
+    t->pressed=(unsigned char)in->pressed;
+    t->released=(unsigned char)in->released;
+    for (k=0;k<KEY_NB;k++)
+    {
+        if (len<=0)
+        {t->held[k]=input_held(in,k) ? INPUT_STEPS : 0;}
+        else
+        {t->held[k]=steps(in->held_ns[k],len);}
+        if (in->pressed & KEY_BIT(k))
+        {t->age[k]=steps(in->tick_end-in->press_time[k],len);}
+    }
+}
+
+void input_expand(const Input_tick *t,Input_snapshot *in)
+{
+    int k;
+    memset(in,0,sizeof(Input_snapshot));
+    in->down=t->down;
+    in->pressed=t->pressed;
+    in->released=t->released;
+    in->tick_start=0;
+    in->tick_end=INPUT_STEPS;
+    for (k=0;k<KEY_NB;k++)
+    {
+        in->held_ns[k]=t->held[k];
+        in->press_time[k]=INPUT_STEPS-t->age[k];
+        in->release_time[k]=INPUT_STEPS;
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <MLV/MLV_all.h>
+
+// touches suivies par le jeu, une par bit
+enum
+{
+    KEY_ESCAPE,
+    KEY_TAB,
+    KEY_LEFT,
+    KEY_RIGHT,
+    KEY_LCTRL,
+    KEY_NB
+};
+
+#define KEY_BIT(k) (1u<<(k))
+
+// changement d'etat d'une touche, date a son arrivee
+typedef struct
+{
+    long long time;     // ns (prof_now_ns)
+    unsigned char key;
+    unsigned char down;
+} Input_event;
+
+// etat du clavier vu par le jeu pendant un tick
+typedef struct
+{
+    unsigned down;      // touches enfoncees a la fin du tick
+    unsigned pressed;   // appuis arrives pendant le tick
+    unsigned released;  // relachements arrives pendant le tick
+    long long press_time[KEY_NB];   // ns du dernier appui
+    long long release_time[KEY_NB];
+    long long tick_start;           // le tick couvre ]tick_start,tick_end]
+    long long tick_end;
+    long long held_ns[KEY_NB];      // temps enfonce pendant le tick
+} Input_snapshot;
+
+// un tick d'entree reduit a des entiers: c'est tout ce que la simulation en lit,
+// ce qu'on enregistre et ce qu'on rejoue, a l'identique
+#define INPUT_STEPS 64  // un tick en 64 pas
+typedef struct
+{
+    unsigned char down;
+    unsigned char pressed;
+    unsigned char released;
+    unsigned char held[KEY_NB];  // pas enfonces pendant le tick
+    unsigned char age[KEY_NB];   // pas depuis l'appui, si appui pendant le tick
+} Input_tick;
+
+void input_init(Input_snapshot *in); // demarre aussi le thread de lecture
+void input_stop();
+void input_poll(Input_snapshot *in); // consomme les evenements arrives, une fois par tick
+int input_held(const Input_snapshot *in,int key); // enfoncee ou tapee pendant le tick
+int input_pressed(const Input_snapshot *in,int key);
+float input_held_fraction(const Input_snapshot *in,int key); // 0..1 du tick
+float input_press_age(const Input_snapshot *in,int key); // part du tick ecoulee depuis l'appui
+void input_quantize(const Input_snapshot *in,Input_tick *t);
+void input_expand(const Input_tick *t,Input_snapshot *in); // snapshot dont le tick dure INPUT_STEPS ns
+
+#endif
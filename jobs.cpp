@@ -0,0 +1,212 @@
+#include "jobs.h"
+
+#include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+// file d'un thread: le proprietaire prend par le bas, les voleurs par le haut
+typedef struct
+{
+    int chunks[JOBS_MAX_CHUNKS];
+    int top;
+    int bottom;
+    int lock;
+    char pad[64-3*sizeof(int)]; // une ligne de cache par verrou
+} Job_deque;
+
+static Job_deque deques[JOBS_MAX_THREADS];
+static SDL_Thread *workers[JOBS_MAX_THREADS];
+static SDL_sem *wake[JOBS_MAX_THREADS];
+static int nb_threads=1;
+static int quit=0;
+
+// la phase en cours
+static Job_fn job_fn;
+static void *job_ctx;
+static int job_n;
+static int job_grain;
+static int job_done;
+
+static void yield()
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+static void deque_lock(Job_deque *d)
+{
+    while (__atomic_exchange_n(&d->lock,1,__ATOMIC_ACQUIRE))
+    {
+        while (__atomic_load_n(&d->lock,__ATOMIC_RELAXED))
+        {yield();}
+    }
+}
+
+static void deque_unlock(Job_deque *d)
+{
+    __atomic_store_n(&d->lock,0,__ATOMIC_RELEASE);
+}
+
+static int deque_take(Job_deque *d,int steal)
+{
+    int c=-1;
+    deque_lock(d);
+    if (d->bottom>d->top)
+    {c=steal ? d->chunks[d->top++] : d->chunks[--d->bottom];}
+    deque_unlock(d);
+    return c;
+}
+
+static void run_chunk(int c)
+{
+    int begin=c*job_grain;
+    int end=begin+job_grain<job_n ? begin+job_grain : job_n;
+    job_fn(job_ctx,c,begin,end);
+    __atomic_add_fetch(&job_done,1,__ATOMIC_RELEASE);
+}
+
+// vider sa file puis voler les autres, jusqu'a ce qu'il n'y ait plus rien
+static void work(int self)
+{
+    int c,k;
+    for (;;)
+    {
+        c=deque_take(&deques[self],0);
+        for (k=1;c<0 && k<nb_threads;k++)
+        {c=deque_take(&deques[(self+k)%nb_threads],1);}
+        if (c<0)
+        {return;}
+        run_chunk(c);
+    }
+}
+
+static int SDLCALL worker_loop(void *data)
+{
+    int self=(int)(long)data;
+    for (;;)
+    {
+        SDL_SemWait(wake[self]);
+        if (__atomic_load_n(&quit,__ATOMIC_ACQUIRE))
+        {break;}
+        work(self);
+    }
+    return 0;
+}
+
+static int cpu_count()
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n=sysconf(_SC_NPROCESSORS_ONLN);
+    return n>0 ? (int)n : 1;
+#endif
+}
+
+int jobs_init(int threads)
+{
+    int i;
+    jobs_stop();
+    if (threads<=0)
+    {threads=cpu_count();}
+    if (threads>JOBS_MAX_THREADS)
+    {threads=JOBS_MAX_THREADS;}
+    quit=0;
+    nb_threads=1;
+    for (i=1;i<threads;i++)
+    {
+        wake[i]=SDL_CreateSemaphore(0);
+        if (wake[i]==NULL)
+        {break;}
+        workers[i]=SDL_CreateThread(worker_loop,(void*)(long)i);
+        if (workers[i]==NULL)
+        {
+            SDL_DestroySemaphore(wake[i]);
+            break;
+        }
+        nb_threads=i+1;
+    }
+    return nb_threads;
+}
+
+void jobs_stop()
+{
+    int i;
+    __atomic_store_n(&quit,1,__ATOMIC_RELEASE);
+    for (i=1;i<nb_threads;i++)
+    {SDL_SemPost(wake[i]);}
+    for (i=1;i<nb_threads;i++)
+    {
+        SDL_WaitThread(workers[i],NULL);
+        SDL_DestroySemaphore(wake[i]);
+    }
+    nb_threads=1;
+}
+
+int jobs_threads()
+{
+    return nb_threads;
+}
+
+int jobs_grain(int n,int grain)
+{
+    if (grain<1)
+    {grain=1;}
+    // au dela de JOBS_MAX_CHUNKS on grossit les morceaux: ne depend toujours que de n
+    if ((n+grain-1)/grain>JOBS_MAX_CHUNKS)
+    {grain=(n+JOBS_MAX_CHUNKS-1)/JOBS_MAX_CHUNKS;}
+    return grain;
+}
+
+int jobs_chunks(int n,int grain)
+{
+    grain=jobs_grain(n,grain);
+    return n>0 ? (n+grain-1)/grain : 0;
+}
+
+int jobs_parallel_for(Job_fn fn,void *ctx,int n,int grain)
+{
+    int nc=jobs_chunks(n,grain);
+    int t,c,first,last;
+    grain=jobs_grain(n,grain);
+    if (nb_threads==1 || nc<=1)
+    {
+        for (c=0;c<nc;c++)
+        {fn(ctx,c,c*grain,c*grain+grain<n ? c*grain+grain : n);}
+        return nc;
+    }
+    job_fn=fn;
+    job_ctx=ctx;
+    job_n=n;
+    job_grain=grain;
+    __atomic_store_n(&job_done,0,__ATOMIC_RELAXED);
+    // des morceaux voisins a chaque thread, le vol equilibre le reste
+    for (t=0;t<nb_threads;t++)
+    {
+        first=t*nc/nb_threads;
+        last=(t+1)*nc/nb_threads;
+        deque_lock(&deques[t]);
+        deques[t].top=0;
+        deques[t].bottom=0;
+        for (c=last-1;c>=first;c--)
+        {deques[t].chunks[deques[t].bottom++]=c;}
+        deque_unlock(&deques[t]);
+    }
+    for (t=1;t<nb_threads;t++)
+    {SDL_SemPost(wake[t]);}
+    work(0);
+    // les derniers morceaux tournent ailleurs: rendre la main plutot que tourner a vide
+    while (__atomic_load_n(&job_done,__ATOMIC_ACQUIRE)<nc)
+    {yield();}
+    return nc;
+}
@@ -0,0 +1,25 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+// ordonnanceur a vol de taches pour les phases du tick: chaque thread a sa file
+// de morceaux, un thread qui n'a plus rien prend dans la file des autres.
+// Le decoupage en morceaux ne depend que de n et du grain, jamais du nombre de
+// threads; chaque morceau ecrit sa propre sortie et l'appelant les reassemble
+// dans l'ordre des morceaux: le resultat est le meme avec 1 ou 16 threads.
+
+#define JOBS_MAX_THREADS 16
+#define JOBS_MAX_CHUNKS 1024
+
+typedef void (*Job_fn)(void *ctx,int chunk,int begin,int end);
+
+int jobs_init(int threads);   // 0: un thread par coeur; renvoie le nombre de threads, appelant compris
+void jobs_stop();
+int jobs_threads();
+
+// decoupe [0,n) en morceaux de grain elements, les execute et attend la fin;
+// renvoie le nombre de morceaux
+int jobs_parallel_for(Job_fn fn,void *ctx,int n,int grain);
+int jobs_chunks(int n,int grain); // nombre de morceaux que jobs_parallel_for utilisera
+int jobs_grain(int n,int grain);  // taille de morceau effective
+
+#endif
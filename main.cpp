@@ -1,16 +1,24 @@
 #include <MLV/MLV_all.h>/
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "broadphase.h"
+#include "collision.h"
+#include "events.h"
+#include "game.h"
+#include "hud.h"
+#include "input.h"
+#include "jobs.h"
+#include "mixer.h"
+#include "particles.h"
+#include "patterns.h"
+#include "profiler.h"
+#include "replay.h"
+#include "shots.h"
+#include "stress.h"
 
     int x=1280;
     int y=960;
-int random(int min,int max)
-{
-    int res;
-    do
-    {
-          res=rand();
-    }while(res<min  || res>max);
-    return res;
-}
 void back_remover(int x,int y) // supprimer des cercles
 {
      MLV_draw_filled_circle( x+60, y+60, 38, MLV_COLOR_BLACK );
@@ -19,19 +27,11 @@ void back_remover2(int x,int y)
 {
      MLV_draw_filled_circle( x+80, y+60, 38, MLV_COLOR_BLACK );
 }
-void back_remover1(int x,int y)
-{
-     MLV_draw_filled_circle( x+15, y+14, 15, MLV_COLOR_BLACK );
-}
 void back_remover3(int x,int y)
 {
      MLV_draw_filled_circle( x+45, y+60, 38, MLV_COLOR_BLACK );
 }
 
-void crash_remover(int x,int y)
-{
-          MLV_clear_window(MLV_COLOR_BLACK);
-}
 void clean_back() //dessiner un rectangle jaune pour effacer les amos
 {
      MLV_draw_filled_rectangle(0,0,y+500,70,MLV_COLOR_YELLOW);
@@ -40,77 +40,269 @@ void down_clean() //effacer les traces de l'avion lorsqu'elle se d
 {
      MLV_draw_filled_rectangle(0,y*9.15/10,y+500,100,MLV_COLOR_BLACK);
 }
-void aff(MLV_Image *amo,MLV_Image *heal,int c,int health) // affichage  le nombre d'amo et des coueurs restants
+void play_events(const Event_buffer *ev,Mixer_sample *shot,Mixer_sample *expo) // tous les sons du tick d'un coup
 {
-                       int P=(y*9/10)-250;
-                          if(c==0)
-                      {
-                      back_remover1(5,P);
-                      back_remover1(5,P+40);
-                      back_remover1(5,P+80);
-                      back_remover1(5,P+120);
-                      }
-                      if (c==1)
-                      {MLV_draw_image(amo,5,P+120);
-                      back_remover1(5,P+80);
-                      
-					  }
-                      if(c==2)
-                      {
-                      	MLV_draw_image(amo,5,P+120);
-                      	MLV_draw_image(amo,5,P+80);
-                      	back_remover1(5,P+40);
-					  }
-					  if(c==3)
-					  {
-					  	  MLV_draw_image(amo,5,P+120);
-					  	  MLV_draw_image(amo,5,P+80); 
-                          MLV_draw_image(amo,5,P+40);
-                          back_remover1(5,P);
-					  }
-					  if(c==4)
-					  {
-					  	MLV_draw_image(amo,5,P);
-					  	MLV_draw_image(amo,5,P+40);
-					  	MLV_draw_image(amo,5,P+80);
-					  	MLV_draw_image(amo,5,P+120);
-					  }
-					  //---------------------------------------//
-					  P-=50;
-                      if(health==0)
-                      {
-                      back_remover1(5,P-40);
-                      back_remover1(5,P-80);
-                      back_remover1(5,P-120);
-                      back_remover1(5,P-160);
-                      }
-                      if (health==1)
-                      {MLV_draw_image(heal,5,P-160);
-                      back_remover1(5,P-120);
-                      
-					  }
-                      if(health==2)
-                      {
-                      	MLV_draw_image(heal,5,P-160);
-                      	MLV_draw_image(amo,5,P-120);
-                      	back_remover1(5,P-120);
-					  }
-					  if(health==3)
-					  {
-					  	  MLV_draw_image(heal,5,P-160);
-					  	  MLV_draw_image(heal,5,P-120); 
-                          MLV_draw_image(heal,5,P-80);
-                          back_remover1(5,P-40);
-					  }
-					  if(health==4)
-					  {
-					  	MLV_draw_image(heal,5,P-160);
-					  	MLV_draw_image(heal,5,P-120);
-					  	MLV_draw_image(heal,5,P-80);
-					  	MLV_draw_image(heal,5,P-40);
-					  }
+     int i;
+     for (i=0;i<ev->count;i++)
+     {
+         const Event *e=&ev->ev[i];
+         if (e->type==EVENT_SPAWN && e->layer==LAYER_FIREBALL)
+         {mixer_play( shot, 1.0, mixer_pan(e->x,x) );}
+         else if (e->type==EVENT_HIT || (e->type==EVENT_DAMAGE && e->layer==LAYER_ALIEN))
+         {mixer_play( expo, 1.0, mixer_pan(e->x,x) );}
+     }
+}
+void draw_events(const Event_buffer *ev,int w,int h) // effacer ce qui a disparu pendant le tick
+{
+     int i;
+     for (i=0;i<ev->count;i++)
+     {
+         const Event *e=&ev->ev[i];
+         if (e->type==EVENT_DESPAWN && e->layer==LAYER_ROCK)
+         {MLV_draw_filled_rectangle(e->x,e->y,w,h,MLV_COLOR_BLACK);}
+         else if (e->type==EVENT_DESPAWN && e->layer==LAYER_FIREBALL)
+         {MLV_draw_filled_rectangle(e->x,e->y,80,50,MLV_COLOR_BLACK);}
+         else if (e->type==EVENT_HIT) // seulement l'ennemi touche, l'explosion fait le reste
+         {MLV_draw_filled_rectangle(e->x-60,e->y,120,100,MLV_COLOR_BLACK);}
+     }
+}
+void emit_particles(const Frame *f,Particles *sparks,Particles *exhaust,unsigned *seed) // les particules naissent des evenements du tick
+{
+     int i;
+     for (i=0;i<f->events.count;i++)
+     {
+         const Event *e=&f->events.ev[i];
+         if (e->type==EVENT_HIT)
+         {particles_burst(sparks,(float)e->x,(float)(e->y+50),3000,7.0f,45,seed);}
+         else if (e->type==EVENT_DAMAGE && e->layer==LAYER_ALIEN)
+         {particles_burst(sparks,(float)e->x,(float)(y*9/10-10),800,4.0f,30,seed);}
+         else if (e->type==EVENT_DAMAGE && e->layer==LAYER_ROCK)
+         {particles_burst(sparks,(float)(e->x+40),(float)(e->y+25),600,3.0f,25,seed);}
+     }
+     if (f->flying) // traine du tir
+     {particles_jet(exhaust,(float)(f->xfireball+40),(float)(f->yfireball+50),40,0.0f,2.5f,14.0f,20,seed);}
+}
+void draw_frame(const Frame *f,MLV_Image *plane,MLV_Image *fireball,MLV_Image *alien,MLV_Image *rock,int rock_w,int rock_h) // dessiner un tick fige
+{
+     int i;
+     down_clean();
+     MLV_draw_image(plane,f->xplane,y*90/100);
+     if (f->fired)
+     {MLV_draw_image(fireball,f->fire_x,f->fire_y);}
+     if (f->flying)
+     {
+      MLV_draw_image(fireball,f->xfireball,f->yfireball);
+      if (f->fireball_erase)
+      {back_remover3(f->xfireball,f->yfireball);}
+     }
+     clean_back(); // effacer les fireballs qui sont arrivs
+     for (i=0;i<NB_ALIENS;i++)
+     {
+         if (f->alien_moved[i]) // la trajectoire ondule: effacer l'ancienne place avant
+         {
+          MLV_draw_filled_rectangle(f->tx_old[i],f->ty_old[i],120,100,MLV_COLOR_BLACK);
+          MLV_draw_image(alien,f->tx[i],f->ty[i]);
+         }
+     }
+     draw_events(&f->events,rock_w,rock_h);
+     for (i=0;i<f->nb_rocks;i++)
+     {
+       if (f->rock_vx[i]==0)
+       {back_remover(FX_INT(f->rock_x[i]),FX_INT(f->rock_y[i]));}
+       else if (FX_INT(f->rock_x[i])!=FX_INT(f->rock_x[i]-f->rock_vx[i]))
+       {
+            if (f->rock_vx[i]<0)
+            {back_remover2(FX_INT(f->rock_x[i])+20,FX_INT(f->rock_y[i])+10);}
+            else
+            {back_remover(FX_INT(f->rock_x[i])+20,FX_INT(f->rock_y[i])+10);}
+       }
+       MLV_draw_image(rock,FX_INT(f->rock_x[i])+50,FX_INT(f->rock_y[i])+80);
+     }
+}
+void draw_menu(MLV_Image *momo) // sommaire pour pouvoir jouer
+{
+	const char *start="PRESS K TO START";
+	const char *exit="PRESS ANY KEY TO EXIT ";
+	const char *tuto=" TUTO:PRESS'<-'to go left/PRESS'->'to go right/ PRESS 'LCTRL' TO SHOOT / YOU HAVE TO DODGE ENEMY SHOOTS & U HAVE TO SLAIN ENNEMIES BEFORE GETTING OUT OF THE WINDOW";
+    const char *window="PRESS ESCAPE TO DISABLE FULLSCREEN / PRESS TAB TO ENABLE FULLSCREEN (IN GAME) ";
+    MLV_clear_window(MLV_COLOR_BLACK);
+    MLV_draw_image(momo,0,0); 
+    MLV_draw_adapted_text_box(x/3,y*2/5,start,25,MLV_COLOR_GREEN,MLV_COLOR_RED,MLV_COLOR_BLACK,MLV_TEXT_CENTER);
+	MLV_draw_adapted_text_box(x/2,y*2/5,exit,25,MLV_COLOR_GREEN,MLV_COLOR_RED,MLV_COLOR_BLACK,MLV_TEXT_CENTER);
+	MLV_draw_adapted_text_box(-30,y*3/5,tuto,25,MLV_COLOR_GREEN,MLV_COLOR_BLUE,MLV_COLOR_BLACK,MLV_TEXT_LEFT);
+	MLV_draw_adapted_text_box(x/4.5,y*4/5,window,25,MLV_COLOR_GREEN,MLV_COLOR_BLUE,MLV_COLOR_BLACK,MLV_TEXT_CENTER);
+}
+typedef struct // les sprites, pour le dessin appele depuis le banc
+{
+    MLV_Image *momo,*plane,*fireball,*alien,*rock,*amo,*heal;
+    int rock_w,rock_h;
+    Hud hud;
+} Sprites;
+void bench_menu(void *ctx)
+{
+     draw_menu(((Sprites*)ctx)->momo);
+}
+void bench_hud(void *ctx,int c,int health)
+{
+     Sprites *s=(Sprites*)ctx;
+     hud_draw(&s->hud,s->amo,s->heal,c,health);
+}
+void bench_frame(void *ctx,const Frame *f)
+{
+     Sprites *s=(Sprites*)ctx;
+     draw_frame(f,s->plane,s->fireball,s->alien,s->rock,s->rock_w,s->rock_h);
+}
+void bench_sprite(void *ctx,int sprite,int px,int py)
+{
+     Sprites *s=(Sprites*)ctx;
+     MLV_Image *images[BENCH_NB_SPRITES]={s->plane,s->alien,s->rock,s->fireball};
+     MLV_draw_image(images[sprite],px,py);
+}
+void draw_state(const Game *g,MLV_Image *plane,MLV_Image *fireball,MLV_Image *alien,MLV_Image *rock,MLV_Image *amo,MLV_Image *heal) // tout redessiner depuis l'etat, sans l'image d'avant
+{
+     int i;
+     Hud hud;
+     MLV_clear_window(MLV_COLOR_BLACK);
+     clean_back();
+     hud_reset(&hud,y);
+     MLV_draw_image(plane,g->xplane,y*90/100);
+     if (g->b==1)
+     {MLV_draw_image(fireball,g->xfireball,g->yfireball);}
+     for (i=0;i<NB_ALIENS;i++)
+     {
+         if (path_launched(&g->paths[i]))
+         {MLV_draw_image(alien,g->tx[i],g->ty[i]);}
+     }
+     for (i=0;i<g->nb_rocks;i++)
+     {MLV_draw_image(rock,FX_INT(g->rock_x[i])+50,FX_INT(g->rock_y[i])+80);}
+     hud_draw(&hud,amo,heal,g->c,g->health);
+}
+void view_replay(const Replay *r,Game *g,Frame *f,MLV_Image *plane,MLV_Image *fireball,MLV_Image *alien,MLV_Image *rock,MLV_Image *amo,MLV_Image *heal) // avancer de 1 a 100 ticks par image, sauter n'importe ou
+{
+     static const int speeds[]={1,2,5,10,25,50,100};
+     MLV_Keyboard_button key;
+     MLV_Button_state state;
+     int speed=0,paused=0,quit=0,target=0,jump;
+     long long t0,seek_ns=0;
+     MLV_change_frame_rate(1000/GAME_TICK_MS);
+     g->seed=~r->seed; // forcer le depart sur la premiere image cle
+     replay_seek(r,g,0,f);
+     while (!quit)
+     {
+           while (MLV_get_event(&key,NULL,NULL,NULL,NULL,NULL,NULL,NULL,&state)!=MLV_NONE)
+           {
+                 if (state!=MLV_PRESSED)
+                 {continue;}
+                 if (key==MLV_KEYBOARD_ESCAPE)
+                 {quit=1;}
+                 else if (key==MLV_KEYBOARD_SPACE)
+                 {paused=!paused;}
+                 else if (key==MLV_KEYBOARD_UP && speed<6)
+                 {speed++;}
+                 else if (key==MLV_KEYBOARD_DOWN && speed>0)
+                 {speed--;}
+                 else if (key==MLV_KEYBOARD_LEFT) // 10 s en arriere
+                 {target=g->tick-10000/GAME_TICK_MS;}
+                 else if (key==MLV_KEYBOARD_RIGHT)
+                 {target=g->tick+10000/GAME_TICK_MS;}
+                 else if (key>=MLV_KEYBOARD_0 && key<=MLV_KEYBOARD_9) // 0 a 90% de la partie
+                 {target=(int)((long long)r->nb_ticks*(key-MLV_KEYBOARD_0)/10);}
+           }
+           if (!paused && target==g->tick)
+           {target=g->tick+speeds[speed];}
+           if (target<0)
+           {target=0;}
+           if (target>r->nb_ticks)
+           {target=r->nb_ticks;}
+           jump=target!=g->tick+speeds[speed];
+           t0=prof_now_ns();
+           replay_seek(r,g,target,f);
+           if (jump)
+           {seek_ns=prof_now_ns()-t0;}
+           draw_state(g,plane,fireball,alien,rock,amo,heal);
+           MLV_draw_text(x/2,10,"%d:%02d / %d:%02d  x%d%s  (saut: %d ms)  ESPACE pause, HAUT/BAS vitesse, GAUCHE/DROITE 10 s, 0-9 position",MLV_COLOR_BLACK,
+                         g->tick*GAME_TICK_MS/60000,g->tick*GAME_TICK_MS/1000%60,r->nb_ticks*GAME_TICK_MS/60000,r->nb_ticks*GAME_TICK_MS/1000%60,
+                         speeds[speed],paused ? " pause" : "",(int)(seek_ns/1000000));
+           MLV_actualise_window();
+           MLV_delay_according_to_frame_rate();
+     }
 }
 int main( int argc, char *argv[] ){ //importer tout les images ncessaires pour jouer et les positionner
+    int profiling=0;int audio_tune=0;int arg;
+    const char *record=NULL; // enregistrer la partie dans ce fichier
+    const char *replay=NULL; // regarder une partie enregistree
+    const char *bench=NULL;int bench_ticks=0;const char *baseline=NULL;double threshold=0.10; // scenes de mesure
+    Stress_config stress;int stressing=0; // mode de charge
+    int verify=0;
+    jobs_init(0); // un thread par coeur pour les phases du tick
+    for (arg=1;arg<argc;arg++)
+    {
+        if (strcmp(argv[arg],"--profile")==0)
+        {profiling=1;}
+        else if (strcmp(argv[arg],"--threads")==0 && arg+1<argc) // le resultat ne depend pas du nombre
+        {jobs_init(atoi(argv[++arg]));}
+        else if (strcmp(argv[arg],"--audio-tune")==0)
+        {audio_tune=1;}
+        else if (strcmp(argv[arg],"--record")==0 && arg+1<argc)
+        {record=argv[++arg];}
+        else if (strcmp(argv[arg],"--replay")==0 && arg+1<argc)
+        {replay=argv[++arg];}
+        else if (strcmp(argv[arg],"--bench")==0 && arg+1<argc) // --bench <scene|all|list> [ticks]
+        {
+            bench=argv[++arg];
+            if (arg+1<argc && argv[arg+1][0]!='-')
+            {bench_ticks=atoi(argv[++arg]);}
+            if (strcmp(bench,"list")==0)
+            {
+                bench_list(stdout);
+                jobs_stop();
+                return 0;
+            }
+        }
+        else if (strcmp(argv[arg],"--stress")==0 && arg+1<argc) // --stress ennemis,bals,tirs,particules[,ticks]
+        {
+            if (stress_parse(&stress,argv[++arg])!=0)
+            {
+                fprintf(stderr,"--stress N,M,P,Q[,ticks]: ennemis, bals ennemies, tirs du joueur, particules\n");
+                jobs_stop();
+                return 1;
+            }
+            stressing=1;
+        }
+        else if (strcmp(argv[arg],"--baseline")==0 && arg+1<argc) // sortie d'un --bench precedent
+        {baseline=argv[++arg];}
+        else if (strcmp(argv[arg],"--threshold")==0 && arg+1<argc) // en %, 10 par defaut
+        {threshold=atof(argv[++arg])/100;}
+        else if (strcmp(argv[arg],"--verify")==0 && arg+1<argc) // rejouer sans afficher et comparer a l'enregistrement
+        {
+            replay=argv[++arg];
+            verify=1;
+        }
+        else if (strcmp(argv[arg],"--bench-shots")==0) // noyau des bals contre la reference scalaire
+        {
+            shots_bench(stdout,arg+1<argc ? atoi(argv[arg+1]) : 50000,1000);
+            jobs_stop();
+            return 0;
+        }
+        else if (strcmp(argv[arg],"--bench-broadphase")==0) // sap contre grille, par type de scene
+        {
+            bp_bench(stdout,arg+1<argc ? atoi(argv[arg+1]) : 2000,200);
+            jobs_stop();
+            return 0;
+        }
+        else if (strcmp(argv[arg],"--bench-snapshot")==0) // sauvegarde et restauration de l'etat complet
+        {
+            game_bench_save(stdout,1000);
+            jobs_stop();
+            return 0;
+        }
+        else if (strcmp(argv[arg],"--bench-particles")==0) // noyau des particules et dessin additif
+        {
+            particles_bench(stdout,arg+1<argc ? atoi(argv[arg+1]) : 100000,300);
+            jobs_stop();
+            return 0;
+        }
+    }
 	MLV_create_window( "beginner - 1 - hello world", "hello world",x,y);
     MLV_Image* momo = MLV_load_image("./data/img/momo.png");
     MLV_Image* plane = MLV_load_image("./data/img/plane.png");
@@ -125,64 +317,103 @@ int main( int argc, char *argv[] ){ //importer tout les images n
 	MLV_resize_image(alien,120,100);
 	MLV_resize_image(fireball,80,50);
 	MLV_resize_image(rock,80,50);
+    Mask plane_mask,alien_mask,fireball_mask,rock_mask; // tires de l'alpha des sprites, une fois
+    if (mask_from_image(&plane_mask,plane)!=0)
+    {mask_box(&plane_mask,100,100);}
+    if (mask_from_image(&alien_mask,alien)!=0)
+    {mask_box(&alien_mask,120,100);}
+    if (mask_from_image(&fireball_mask,fireball)!=0)
+    {mask_box(&fireball_mask,80,50);}
+    if (mask_from_image(&rock_mask,rock)!=0)
+    {mask_box(&rock_mask,80,50);}
+    if (bench!=NULL || stressing) // rien n'est affiche: le dessin reste sur la surface de la fenetre
+    {
+        Sprites sprites={momo,plane,fireball,alien,rock,amo,heal,rock_mask.w,rock_mask.h};
+        hud_reset(&sprites.hud,y);
+        Bench_env env={x,y,&plane_mask,&alien_mask,&fireball_mask,&rock_mask,bench_menu,bench_hud,bench_frame,bench_sprite,&sprites};
+        patterns_init();
+        if (stressing)
+        {
+            int over=stress_run(stdout,&stress,&env);
+            if (over<0)
+            {fprintf(stderr,"stress: pas assez de memoire pour ces nombres\n");}
+            jobs_stop();
+            MLV_free_window();
+            return over<0 ? 1 : 0;
+        }
+        int regressions=bench_run(stdout,bench,bench_ticks,&env,baseline,threshold);
+        if (regressions<0)
+        {
+            fprintf(stderr,"bench: scene inconnue '%s', au choix:\n",bench);
+            bench_list(stderr);
+        }
+        jobs_stop();
+        MLV_free_window();
+        return regressions<0 ? 1 : (regressions>0 ? 3 : 0);
+    }
     MLV_init_audio( );
-	MLV_change_number_of_parallel_sounds ( 	4	);
-    MLV_Sound* sound;
-    MLV_Sound* expo = MLV_load_sound( "./data/img/expo.ogg" ); ;
+    mixer_init(); // les effets passent par notre mixeur, la musique reste a MLV
+    Mixer_sample* shot = mixer_load( "./data/img/shot.ogg" );
+    Mixer_sample* expo = mixer_load( "./data/img/expo.ogg" );
+    if (audio_tune) // mesurer latence et trous, garder le plus petit buffer stable
+    {mixer_tune_buffer(expo,stdout);}
     MLV_Music* beb = MLV_load_music( "./data/img/fugue.ogg" );
         MLV_play_music( beb, 1.0, -1 );
-    int quit=0;int q=0;
-	int xplane=x/2;
-	int yfireball=y*9/10;
-	int k=0;int j;
-	int yalien=0;
-	int xalien,i;
-	int tx[40];
-	int ty[40];
-	int veriff[40];
-	int veriff1[40];
-	int vx[40];
-	int vy[40];
-	int vt[40];
-	int kk=0;
-
-	int b=0;
-	int xtarget;
-	int delaishoot=0;
-	int dx=0;
-	int dy=0;
-	int r;
-	int health=4;
-	int xfireball;
-	int pass=0;
-	int verif;
-	int compteur=0;
-	int constanttemp=0;
-	int reload=0;
-	int deltax=0;
-	int deltay=0;
-	int nb_alien_alive=0;
-	int c=4, n=1,P=(y*90/100)-200;
+    Game *game=game_new(x,y,&plane_mask,&alien_mask,&fireball_mask,&rock_mask); // l'etat du jeu, ecrit par le thread de simulation
+	if (game==NULL)
+	{return 1;}
+	patterns_init();
+	Frame frames[2]; // le rendu lit l'une pendant que la simulation ecrit l'autre
+	int front=0;
+	int over;
+	long long t0;
+	if (frame_init(&frames[0],SHOTS_MAX)!=0 || frame_init(&frames[1],SHOTS_MAX)!=0)
+	{return 1;}
+	if (replay!=NULL)
+	{
+        Replay rep;
+        if (replay_load(&rep,replay)!=0 || rep.w!=x || rep.h!=y)
+        {
+            fprintf(stderr,"%s: replay illisible ou pour une autre fenetre\n",replay);
+            return 1;
+        }
+        if (replay_index(&rep,game,&frames[0],stdout)!=0) // les images cles et la verification, une passe sans affichage
+        {return 1;}
+        replay_report(stdout,&rep);
+        MLV_stop_music();
+        if (!verify) // sinon seulement la verification
+        {view_replay(&rep,game,&frames[0],plane,fireball,alien,rock,amo,heal);}
+        int diverged=rep.diverged>=0;
+        replay_free(&rep);
+        game_delete(game);
+        mixer_free();
+        jobs_stop();
+        MLV_free_window();
+        return diverged ? 2 : 0;
+	}
+	Particles sparks,exhaust; // sur le thread de la fenetre: ce n'est que de l'affichage
+	Particle_layer fx;
+	unsigned fx_seed=1;
+	Hud hud;
+	if (particles_init(&sparks,PARTICLES_MAX,0.95f,0.08f,255,120,30)!=0 || particles_init(&exhaust,16384,0.90f,0.0f,80,150,255)!=0)
+	{return 1;}
+	if (particles_layer_init(&fx,x,y)!=0)
+	{fprintf(stderr,"particules: pas de tampon 32 bits, pas d'effets\n");}
+    int quit=0;
+	int n=1,P=(y*90/100)-200;
     int d=P;
     int fullscreen=0;
     int nfullscreen=0;
     int play=0;
     MLV_Keyboard_button touche; 
-	const char *start="PRESS K TO START";
-	const char *exit="PRESS ANY KEY TO EXIT ";
-	const char *tuto=" TUTO:PRESS'<-'to go left/PRESS'->'to go right/ PRESS 'LCTRL' TO SHOOT / YOU HAVE TO DODGE ENEMY SHOOTS & U HAVE TO SLAIN ENNEMIES BEFORE GETTING OUT OF THE WINDOW";
-    const char *window="PRESS ESCAPE TO DISABLE FULLSCREEN / PRESS TAB TO ENABLE FULLSCREEN (IN GAME) ";
+    Input_snapshot in;
+    Input_tick in_tick; // ce que la simulation lit vraiment, enregistre tel quel
+    Input_snapshot sim_in;
 	while(play==0)
 	{
                   MLV_enable_full_screen();
 
-                  MLV_clear_window(MLV_COLOR_BLACK);
-    // sommaire pour pouvoir jouer
-    MLV_draw_image(momo,0,0); 
-    MLV_draw_adapted_text_box(x/3,y*2/5,start,25,MLV_COLOR_GREEN,MLV_COLOR_RED,MLV_COLOR_BLACK,MLV_TEXT_CENTER);
-	MLV_draw_adapted_text_box(x/2,y*2/5,exit,25,MLV_COLOR_GREEN,MLV_COLOR_RED,MLV_COLOR_BLACK,MLV_TEXT_CENTER);
-	MLV_draw_adapted_text_box(-30,y*3/5,tuto,25,MLV_COLOR_GREEN,MLV_COLOR_BLUE,MLV_COLOR_BLACK,MLV_TEXT_LEFT);
-	MLV_draw_adapted_text_box(x/4.5,y*4/5,window,25,MLV_COLOR_GREEN,MLV_COLOR_BLUE,MLV_COLOR_BLACK,MLV_TEXT_CENTER);
+                  draw_menu(momo);
 	
 	MLV_actualise_window();
 	
@@ -195,14 +426,29 @@ int main( int argc, char *argv[] ){ //importer tout les images n
 	
 	if(touche != MLV_KEYBOARD_k)
 	{
+              if (profiling)
+              {
+                 prof_report(stdout);
+                 prof_report_histogram(stdout,PROF_INPUT_DISPLAY);
+                 mixer_report(stdout);
+                 toi_report(stdout,&game->toi);
+              }
+              particles_layer_free(&fx);
+              particles_free(&sparks);
+              particles_free(&exhaust);
+              game_delete(game);
+              mixer_free();
+              jobs_stop();
               MLV_free_window();
+              play=1;
     }
 	if (touche==MLV_KEYBOARD_k) //commencer  jouer
 	{
         
-        xplane=x/2;
         quit=0;
-        health=4;
+        game_reset(game,(unsigned)rand());
+        if (record!=NULL && replay_open(record,x,y,game->seed)!=0)
+        {fprintf(stderr,"%s: impossible d'enregistrer\n",record);}
         MLV_stop_music();
         MLV_free_music(beb);
         MLV_Music* jed = MLV_load_music( "./data/img/BB.ogg" );
@@ -210,204 +456,81 @@ int main( int argc, char *argv[] ){ //importer tout les images n
 	   
         MLV_enable_full_screen();
        
-        for (i=0;i<40;i++)
-        	{
-        	vt[i]=0;
-        	vx[i]=-900;
-        	vy[i]=0;
-        	veriff[i]=0;
-        	veriff1[i]=0;
-            tx[i]=random(0,x*9/10);
-            ty[i]=0;}
-        k=0;
-        verif=0;
-        compteur=0;
-          
         MLV_enable_full_screen();
-       
+        input_init(&in);
+        sparks.count=0;
+        exhaust.count=0;
+        hud_reset(&hud,y);
+        sim_start();
+        input_poll(&in); // le premier tick n'a rien a dessiner en face
+        input_quantize(&in,&in_tick);
+        input_expand(&in_tick,&sim_in);
+        replay_write(&in_tick,game);
+        front=0;
+        sim_begin(game,&sim_in,&frames[front]);
+        sim_end();
+        MLV_change_frame_rate(1000/GAME_TICK_MS); // un tick par image, au pas de la simulation
       
     
         while(quit==0) //condition d'echec
     	{
-                      down_clean();
-                      
-                         
-                      if (MLV_get_keyboard_state(MLV_KEYBOARD_ESCAPE)==MLV_PRESSED) 
+                      input_poll(&in); // un seul releve du clavier par tick
+                      input_quantize(&in,&in_tick);
+                      input_expand(&in_tick,&sim_in);
+                      if (input_pressed(&in,KEY_LEFT))
+                      {probe_press(KEY_LEFT,in.press_time[KEY_LEFT]);}
+                      if (input_pressed(&in,KEY_RIGHT))
+                      {probe_press(KEY_RIGHT,in.press_time[KEY_RIGHT]);}
+                      if (input_pressed(&in,KEY_LCTRL))
+                      {probe_press(KEY_LCTRL,in.press_time[KEY_LCTRL]);}
+                      if (input_pressed(&in,KEY_ESCAPE)) 
                       {
                        MLV_disable_full_screen();
                       }
-                      if (MLV_get_keyboard_state(MLV_KEYBOARD_TAB)==MLV_PRESSED)
+                      if (input_pressed(&in,KEY_TAB))
                       {
                        MLV_enable_full_screen();
                       }
-                    if ((MLV_get_time()%850)==0 && k<36 ) // le delai de l'apparition des ennemis et condition sur le nombre d'ennemis envoys
-                      {
-                           if ((MLV_get_time()/850)<=1)
-                           {r=2;}
-                           else
-                           {r=random(1,2);}
-                           for (i=k;i<k+r;i++)
-                               {
-                                   if (ty[i]<=1)
-                                       {
-                                       ty[i]+=1;
-                                       }
-
-                               }
-                               k+=r;
-                               
-                      }
-                      else if(k>=36)
+                      // le tick suivant se calcule pendant qu'on dessine celui-ci:
+                      // la duree d'une image est le plus long des deux, pas leur somme
+                      over=frames[front].over;
+                      if (!over)
+                      {replay_write(&in_tick,game);}
+                      if (!over)
+                      {sim_begin(game,&sim_in,&frames[1-front]);}
+                      t0=prof_now_ns();
+                      particles_erase(&fx); // avant les sprites pour ne pas les manger
+                      draw_frame(&frames[front],plane,fireball,alien,rock,rock_mask.w,rock_mask.h);
+                      emit_particles(&frames[front],&sparks,&exhaust,&fx_seed);
+                      particles_update(&sparks,x,y);
+                      particles_update(&exhaust,x,y);
+                      particles_draw(&fx,&exhaust);
+                      particles_draw(&fx,&sparks);
+                      particles_present(&fx);
+                      hud_draw(&hud,amo,heal,frames[front].c,frames[front].health);
+                      play_events(&frames[front].events,shot,expo);
+                      probe_tick(KEY_LEFT,frames[front].held & KEY_BIT(KEY_LEFT),frames[front].effects & KEY_BIT(KEY_LEFT));
+                      probe_tick(KEY_RIGHT,frames[front].held & KEY_BIT(KEY_RIGHT),frames[front].effects & KEY_BIT(KEY_RIGHT));
+                      probe_tick(KEY_LCTRL,frames[front].held & KEY_BIT(KEY_LCTRL),frames[front].effects & KEY_BIT(KEY_LCTRL));
+                      MLV_actualise_window();
+                      prof_add(PROF_RENDER,prof_now_ns()-t0);
+                      probe_present();
+                      MLV_delay_according_to_frame_rate();
+                      if (!over)
                       {
-                                    k=0;
+                       sim_end();
+                       front=1-front; // echange a la frontiere du tick
                       }
-    
-                      if (MLV_get_keyboard_state(MLV_KEYBOARD_LEFT)==MLV_PRESSED && xplane>0)
-                        {
-                        xplane-=2;
-                        }
-                      else if(MLV_get_keyboard_state(MLV_KEYBOARD_RIGHT)==MLV_PRESSED && xplane<x*9/10)
-                        {
-                        xplane+=2;
-                        }
-                        MLV_draw_image(plane,xplane,y*90/100);
-                          
-                          
-                      if (MLV_get_keyboard_state(MLV_KEYBOARD_LCTRL)==MLV_PRESSED && b==0 && c!=0&& (MLV_get_time()/500-reload)!=0) //controler fireball
-                        {
-						   c-=1; 
-						   reload=MLV_get_time()/500;
-                           MLV_draw_image(fireball,xplane,yfireball-40);
-                          sound = MLV_load_sound( "./data/img/shot.ogg" );
-                        	MLV_play_sound( sound, 1.0 );
-                        	
-                        
-                           xfireball=xplane;
-                           b=1;
-                        }
-                      if (b==1 && yfireball>0)
-                      {
-                       yfireball-=3;
-                       MLV_draw_image(fireball,xfireball,yfireball);
-                       if (yfireball>=0 && yfireball<=10)
-                        {
-                        b=0;
-                        yfireball=y*9/10;
-                        }
-                      else if( yfireball<=(y*90/100)-40)
-                        {
-                             back_remover3(xfireball,yfireball);
-                        }
-                       
-                       
-                      }
-                      clean_back(); // effacer les fireballs qui sont arrivs 
-
-                          for (j=0;j<40;j++)
-                          {
-                              if (compteur%7==0 && ty[j]%2==1 && ty[j]<y*9/10)
-                              {   ty[j]+=2*random(1,3);
-                                  MLV_draw_image(alien,tx[j],ty[j]);
-                               } 
-                              
-                          
-                               // hitbox
-                              if   ((yfireball<=ty[j]+10 && yfireball>=ty[j]-10)&&(xfireball <= tx[j]+80 &&xfireball >= tx[j]-80))
-                                   {  
-                                       
-                                  	   MLV_play_sound( expo, 1000.0 );
-                                       crash_remover(tx[j]+40,ty[j]+40);//effacer l'avion et l'ennemi lorsqu'ils se croisent
-                                       aff(amo,heal,c,health);
-                                       b=0;
-                                       yfireball=y*9/10;
-                                       ty[j]=0;
-                                       veriff[i]=0;
-                                       tx[j]=random(0,x*9/10);
-                                       
-                                   }
-                              if (ty[j]>=y*9/10)
-                              {
-                               ty[j]=0;
-                               tx[j]=random(0,x*9/10);
-                               MLV_play_sound( expo, 1000.0 );
-                               health-=1;
-                              }
-                        }
-                       for (i=0;i<40;i++) 
-                            {
-                              if (ty[i]<=y*9/10 && ty[i]>y/40 && verif==0) //positionner les bals des ennemis
-                              {
-                                      vx[i]=tx[i];
-                                      vy[i]=ty[i];
-                                      vt[i]=xplane;//avoir la position du cible
-                                      verif=1;  
-                              }
-                              dx=vt[i]-40-vx[i];
-                              dy=(y*9/10)-vy[i];
-                              
-                              
-                              if (vx[i]!=-900 && vy[i]<y*9/10)
-                                {
-                                   if (dx!=0)
-                                   {q=(dy/dx);}
-                                   else
-                                   {back_remover(vx[i],vy[i]);} 
-                                   
-                                   vy[i]+=1; 
-                                   if (q<0)
-                                   {  q=-q;
-                                      if((MLV_get_time()*5)%q==0)
-                                          {vx[i]-=1;
-                                          back_remover2(vx[i]+20,vy[i]+10);
-                                          }
-                                   }
-                                   else if(q>0)
-                                   {
-                                        if(MLV_get_time()%q==0)
-                                        {vx[i]+=1;
-                                        back_remover(vx[i]+20,vy[i]+10);
-                                        }
-                                   }
-                                      
-                                } 
-                              if(vy[i]==y*9/10)
-                              {
-                                verif=0;
-                                if (vx[i]>=xplane-50 && vx[i]<=xplane+50) //hitbox pour l'avion
-                                   {health-=1;}
-                              vx[i]=-900;
-                              vy[i]=0;
-                              } 
-                              MLV_draw_image(rock,vx[i]+50,vy[i]+80);
-                              
-                            }
-                        
-                        
-                        
-                        compteur+=1;
-                        if (compteur==100)
-                        {compteur=0;}
-                        
- 
-					  if ((MLV_get_time()%400)==0 && c<4)
-						{
-							c+=1; // augmenter le nb d'amo au cours du temps
-						} 
-                      if ((MLV_get_time()%15000)==0 && health<4)
-						{
-							health+=1; //augmenter le nb de coeur de l'avion
-						}
-						aff(amo,heal,c,health);
-	                  if(health==0)
-	                  {quit=1;
+                      else
+                      {quit=1;
+                   sim_stop();
+                   input_stop();
+                   if (record!=NULL && replay_close()!=0)
+                   {fprintf(stderr,"%s: replay incomplet\n",record);}
                    MLV_stop_music();
                    MLV_free_music(jed);
                    MLV_Music* beb = MLV_load_music( "./data/img/menu.ogg" );
                     MLV_play_music( beb, 100.0, -1 );}
-					   
-                          
-                        MLV_actualise_window();
-                        
         }
           
   }
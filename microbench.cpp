@@ -0,0 +1,280 @@
+#include <MLV/MLV_all.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "collision.h"
+#include "hud.h"
+#include "motion.h"
+#include "profiler.h"
+
+// micro-banc: les fonctions chaudes une par une, hors de la boucle de jeu, pour voir
+// une regression de quelques ns avant qu'elle se perde dans le bruit d'une image.
+// Chaque mesure: echauffement, puis MICRO_SAMPLES echantillons qui appellent la fonction
+// assez de fois pour durer MICRO_SAMPLE_NS; on donne la mediane, le min et l'ecart type
+// entre echantillons. Se construit a part: mingw32-make -f Makefile.win microbench
+#define MICRO_SAMPLES 31
+#define MICRO_SAMPLE_NS 2000000LL   // 2 ms par echantillon
+#define MICRO_WARMUP_NS 50000000LL  // 50 ms d'echauffement
+
+static const int x=1280;
+static const int y=960;
+
+typedef struct
+{
+    const char *name;
+    void (*run)(int n);   // n appels de la fonction mesuree
+    const char *what;
+} Micro;
+
+static MLV_Image *amo,*heal,*alien,*rock,*fireball;
+static Mask alien_mask,fireball_mask;
+static Hud hud;
+static unsigned seed=12345;
+static int tick;
+static volatile int sink; // les resultats vont ici, sinon le compilateur retire les appels
+
+// l'ancien random() de main.cpp: rand() jusqu'a tomber dans [min,max]
+static int old_random(int min,int max)
+{
+    int res;
+    do
+    {
+          res=rand();
+    }while(res<min  || res>max);
+    return res;
+}
+
+// le tirage de game_random
+static int bounded_random(unsigned *state,int min,int max)
+{
+    return min+(int)(motion_rand(state)%(unsigned)(max-min+1));
+}
+
+static void run_old_random_x(int n)
+{
+    int i,s=0;
+    for (i=0;i<n;i++)
+    {s+=old_random(0,x*9/10);} // depart d'un ennemi
+    sink=s;
+}
+
+static void run_old_random_r(int n)
+{
+    int i,s=0;
+    for (i=0;i<n;i++)
+    {s+=old_random(1,2);} // nombre d'ennemis lances; RAND_MAX=32767 avec MinGW: ~16000 rand() par appel
+    sink=s;
+}
+
+static void run_game_random(int n)
+{
+    int i,s=0;
+    for (i=0;i<n;i++)
+    {s+=bounded_random(&seed,1,2);}
+    sink=s;
+}
+
+static void run_path_at(int n)
+{
+    Path p;
+    int i,ax,ay,s=0;
+    path_set(&p,seed);
+    path_launch(&p,0);
+    for (i=0;i<n;i++)
+    {
+        path_at(&p,tick++%1000,x*9/10,&ax,&ay);
+        s+=ax+ay;
+    }
+    sink=s;
+}
+
+// le tir monte de 3 pixels par tick a travers un ennemi: touche une fois sur deux
+static void run_fireball_hit(int n)
+{
+    Body a,b;
+    float t;
+    int i,s=0;
+    body_set(&b,600,400,0,1,alien_mask.w,alien_mask.h,&alien_mask,LAYER_ALIEN,LAYER_FIREBALL|LAYER_EDGE,0);
+    for (i=0;i<n;i++)
+    {
+        body_set(&a,600+(i%40),400+alien_mask.h-(i%(2*alien_mask.h)),0,-3,fireball_mask.w,fireball_mask.h,&fireball_mask,LAYER_FIREBALL,LAYER_ALIEN,0);
+        s+=body_contact(&a,&b,&t);
+    }
+    sink=s;
+}
+
+static void run_aff(int n)
+{
+    int i;
+    for (i=0;i<n;i++)
+    {aff(amo,heal,4,4,y);}
+}
+
+static void run_hud_draw(int n)
+{
+    int i;
+    for (i=0;i<n;i++)
+    {hud_draw(&hud,amo,heal,4,4);}
+}
+
+// un compteur qui change a chaque appel
+static void run_aff_churn(int n)
+{
+    int i;
+    for (i=0;i<n;i++,tick++)
+    {aff(amo,heal,tick%5,(tick/5)%5,y);}
+}
+
+static void run_hud_draw_churn(int n)
+{
+    int i;
+    for (i=0;i<n;i++,tick++)
+    {hud_draw(&hud,amo,heal,tick%5,(tick/5)%5);}
+}
+
+static void blit(MLV_Image *image,int n)
+{
+    int i;
+    for (i=0;i<n;i++,tick++)
+    {MLV_draw_image(image,(tick*97)%(x-120),(tick*61)%(y-100));}
+}
+
+static void run_blit_28(int n)
+{
+    blit(amo,n);
+}
+
+static void run_blit_80(int n)
+{
+    blit(rock,n);
+}
+
+static void run_blit_120(int n)
+{
+    blit(alien,n);
+}
+
+static void run_clear(int n)
+{
+    int i;
+    for (i=0;i<n;i++)
+    {MLV_clear_window(MLV_COLOR_BLACK);}
+}
+
+static const Micro micros[]=
+{
+    {"old_random_x",run_old_random_x,"ancien random(0,x*9/10), rejet sur rand()"},
+    {"old_random_r",run_old_random_r,"ancien random(1,2), rejet sur rand()"},
+    {"game_random",run_game_random,"tirage borne de game_random"},
+    {"path_at",run_path_at,"position d'un ennemi a un tick"},
+    {"fireball_hit",run_fireball_hit,"body_contact tir contre ennemi, au pixel"},
+    {"aff",run_aff,"ancien affichage des munitions et coeurs, compteurs fixes"},
+    {"hud_draw",run_hud_draw,"nouvel affichage, compteurs fixes"},
+    {"aff_churn",run_aff_churn,"ancien affichage, compteurs qui changent"},
+    {"hud_draw_churn",run_hud_draw_churn,"nouvel affichage, compteurs qui changent"},
+    {"blit_28x28",run_blit_28,"MLV_draw_image d'une munition"},
+    {"blit_80x50",run_blit_80,"MLV_draw_image d'une bal"},
+    {"blit_120x100",run_blit_120,"MLV_draw_image d'un ennemi"},
+    {"clear",run_clear,"MLV_clear_window de toute la fenetre"}
+};
+
+#define NB_MICROS ((int)(sizeof(micros)/sizeof(micros[0])))
+
+static int by_value(const void *a,const void *b)
+{
+    double d=*(const double*)a-*(const double*)b;
+    return d<0 ? -1 : d>0;
+}
+
+static void measure(const Micro *m)
+{
+    double ns[MICRO_SAMPLES],mean=0,var=0;
+    long long t0,t,warm;
+    int n=1,i;
+    // doubler n jusqu'a un echantillon assez long; cela fait partie de l'echauffement
+    warm=prof_now_ns();
+    for (;;)
+    {
+        t0=prof_now_ns();
+        m->run(n);
+        t=prof_now_ns()-t0;
+        if (t>=MICRO_SAMPLE_NS || n>=(1<<28))
+        {break;}
+        n*=2;
+    }
+    while (prof_now_ns()-warm<MICRO_WARMUP_NS)
+    {m->run(n);}
+    for (i=0;i<MICRO_SAMPLES;i++)
+    {
+        t0=prof_now_ns();
+        m->run(n);
+        ns[i]=(double)(prof_now_ns()-t0)/n;
+        mean+=ns[i];
+    }
+    mean/=MICRO_SAMPLES;
+    for (i=0;i<MICRO_SAMPLES;i++)
+    {var+=(ns[i]-mean)*(ns[i]-mean);}
+    var/=MICRO_SAMPLES-1;
+    qsort(ns,MICRO_SAMPLES,sizeof(double),by_value);
+    printf("%-16s %12.1f %12.1f %10.2f %6.2f%% %10d  %s\n",
+           m->name,ns[MICRO_SAMPLES/2],ns[0],sqrt(var),mean>0 ? 100*sqrt(var)/mean : 0.0,n,m->what);
+    fflush(stdout);
+}
+
+static MLV_Image *load(const char *path,int w,int h)
+{
+    MLV_Image *image=MLV_load_image(path);
+    if (image==NULL)
+    {
+        fprintf(stderr,"%s: image introuvable\n",path);
+        exit(1);
+    }
+    MLV_resize_image(image,w,h);
+    return image;
+}
+
+// microbench [nom...]: tout, ou seulement les mesures nommees; microbench list
+int main(int argc,char *argv[])
+{
+    int i,a,done=0;
+    if (argc>1 && strcmp(argv[1],"list")==0)
+    {
+        for (i=0;i<NB_MICROS;i++)
+        {printf("  %-16s %s\n",micros[i].name,micros[i].what);}
+        return 0;
+    }
+    MLV_create_window("microbench","microbench",x,y);
+    amo=load("./data/img/der der.png",28,28);
+    heal=load("./data/img/heal.png",28,28);
+    rock=load("./data/img/rock.png",80,50);
+    fireball=load("./data/img/fireball.png",80,50);
+    alien=load("./data/img/alien.png",120,100);
+    if (mask_from_image(&alien_mask,alien)!=0)
+    {mask_box(&alien_mask,120,100);}
+    if (mask_from_image(&fireball_mask,fireball)!=0)
+    {mask_box(&fireball_mask,80,50);}
+    hud_reset(&hud,y);
+    srand(12345);
+    printf("%-16s %12s %12s %10s %7s %10s\n","mesure","mediane ns","min ns","ecart ns","cv","appels");
+    for (i=0;i<NB_MICROS;i++)
+    {
+        for (a=1;a<argc && strcmp(argv[a],micros[i].name)!=0;a++)
+        {}
+        if (argc>1 && a==argc)
+        {continue;}
+        measure(&micros[i]);
+        done++;
+    }
+    mask_free(&alien_mask);
+    mask_free(&fireball_mask);
+    MLV_free_image(amo);
+    MLV_free_image(heal);
+    MLV_free_image(rock);
+    MLV_free_image(fireball);
+    MLV_free_image(alien);
+    MLV_free_window();
+    if (done==0)
+    {fprintf(stderr,"aucune mesure de ce nom, voir: microbench list\n");}
+    return done>0 ? 0 : 1;
+}
@@ -0,0 +1,17 @@
+# micro-banc: un executable a part, avec son propre main, hors des unites du projet.
+# Inclus par Makefile.win (Projet > Options > Makefile): mingw32-make -f Makefile.win microbench
+MICRO_OBJ = ./obj/microbench.o ./obj/hud.o ./obj/collision.o ./obj/broadphase.o ./obj/jobs.o ./obj/motion.o ./obj/profiler.o
+MICRO_BIN = final_product/microbench.exe
+
+.PHONY: microbench
+
+microbench: $(MICRO_BIN)
+
+$(MICRO_BIN): $(MICRO_OBJ)
+	$(CPP) $(MICRO_OBJ) -o $(MICRO_BIN) $(LIBS)
+
+./obj/microbench.o: microbench.cpp
+	$(CPP) -c microbench.cpp -o ./obj/microbench.o $(CXXFLAGS)
+
+clean-custom:
+	${RM} ./obj/microbench.o $(MICRO_BIN)
@@ -0,0 +1,315 @@
+#include "mixer.h"
+#include "profiler.h"
+
+#include <MLV/MLV_audio.h>
+#include <stdlib.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+typedef struct
+{
+    const Sint16 *data;  // echantillons stereo entrelaces G,D,G,D...
+    int frames;
+    int pos;
+    Sint16 gain[2];      // Q15 gauche/droite
+    long long queued;    // date de l'appel a mixer_play
+} Voice;
+
+typedef void (*Mix_kernel)(Sint16 *out,const Sint16 *in,int n,const Sint16 *gain);
+
+static Voice voices[MIXER_VOICES];
+static int nb_voices=0;  // les voix actives sont compactees en tete du tableau
+static int mixer_ok=0;
+static int mixer_freq=0;
+static int buffer_frames=0;
+static int underruns=0;
+static long long last_callback=0;
+static Mix_kernel mix_kernel;
+static const char *kernel_name="none";
+
+// n = nombre d'echantillons (2 par trame), la gain alterne gauche/droite
+static void mix_scalar(Sint16 *out,const Sint16 *in,int n,const Sint16 *gain)
+{
+    int i;
+    for (i=0;i<n;i++)
+    {
+        int v=out[i]+((in[i]*gain[i&1])>>15);
+        if (v>32767)
+        {v=32767;}
+        else if (v<-32768)
+        {v=-32768;}
+        out[i]=(Sint16)v;
+    }
+}
+
+static void mix_sse2(Sint16 *out,const Sint16 *in,int n,const Sint16 *gain)
+{
+    __m128i g=_mm_set_epi16(gain[1],gain[0],gain[1],gain[0],gain[1],gain[0],gain[1],gain[0]);
+    int i=0;
+    for (;i+8<=n;i+=8)
+    {
+        __m128i a=_mm_loadu_si128((const __m128i*)(in+i));
+        __m128i lo=_mm_mullo_epi16(a,g);
+        __m128i hi=_mm_mulhi_epi16(a,g);
+        __m128i p0=_mm_srai_epi32(_mm_unpacklo_epi16(lo,hi),15);
+        __m128i p1=_mm_srai_epi32(_mm_unpackhi_epi16(lo,hi),15);
+        __m128i o=_mm_loadu_si128((const __m128i*)(out+i));
+        _mm_storeu_si128((__m128i*)(out+i),_mm_adds_epi16(o,_mm_packs_epi32(p0,p1)));
+    }
+    mix_scalar(out+i,in+i,n-i,gain);
+}
+
+__attribute__((target("avx2")))
+static void mix_avx2(Sint16 *out,const Sint16 *in,int n,const Sint16 *gain)
+{
+    __m256i g=_mm256_set_epi16(gain[1],gain[0],gain[1],gain[0],gain[1],gain[0],gain[1],gain[0],
+                               gain[1],gain[0],gain[1],gain[0],gain[1],gain[0],gain[1],gain[0]);
+    int i=0;
+    for (;i+16<=n;i+=16)
+    {
+        // unpack/pack travaillent par moitie de 128 bits: l'ordre est conserve
+        __m256i a=_mm256_loadu_si256((const __m256i*)(in+i));
+        __m256i lo=_mm256_mullo_epi16(a,g);
+        __m256i hi=_mm256_mulhi_epi16(a,g);
+        __m256i p0=_mm256_srai_epi32(_mm256_unpacklo_epi16(lo,hi),15);
+        __m256i p1=_mm256_srai_epi32(_mm256_unpackhi_epi16(lo,hi),15);
+        __m256i o=_mm256_loadu_si256((const __m256i*)(out+i));
+        _mm256_storeu_si256((__m256i*)(out+i),_mm256_adds_epi16(o,_mm256_packs_epi32(p0,p1)));
+    }
+    mix_sse2(out+i,in+i,n-i,gain);
+}
+
+// appele par SDL_mixer sur le thread audio, apres le mixage de la musique
+static void mixer_callback(void *udata,Uint8 *stream,int len)
+{
+    long long t0=prof_now_ns();
+    Sint16 *out=(Sint16*)stream;
+    int frames=len/4;
+    long long budget=frames*1000000000LL/mixer_freq;
+    int v=0;
+    // SDL ne signale pas les trous: un appel en retard de plus d'un
+    // demi-buffer veut dire que la carte son a joue du vide
+    if (last_callback!=0 && t0-last_callback>budget+budget/2)
+    {underruns+=1;}
+    last_callback=t0;
+    while (v<nb_voices)
+    {
+          Voice *vo=&voices[v];
+          int n=vo->frames-vo->pos;
+          if (vo->pos==0)
+          {prof_add(PROF_AUDIO_LATENCY,t0-vo->queued);}
+          if (n>frames)
+          {n=frames;}
+          mix_kernel(out,vo->data+2*vo->pos,2*n,vo->gain);
+          vo->pos+=n;
+          if (vo->pos>=vo->frames)
+          {voices[v]=voices[--nb_voices];} // voix finie: la derniere prend sa place
+          else
+          {v++;}
+    }
+    buffer_frames=frames;
+    prof_add(PROF_AUDIO_MIX,prof_now_ns()-t0);
+}
+
+int mixer_init()
+{
+    int channels;
+    Uint16 format;
+    mixer_free();
+    if (Mix_QuerySpec(&mixer_freq,&format,&channels)==0 || format!=AUDIO_S16SYS || channels!=2)
+    {
+        fprintf(stderr,"mixer: format audio non supporte, retour aux canaux SDL_mixer\n");
+        return -1;
+    }
+    mix_kernel=mix_sse2;
+    kernel_name="sse2";
+    if (__builtin_cpu_supports("avx2"))
+    {
+        mix_kernel=mix_avx2;
+        kernel_name="avx2";
+    }
+    Mix_SetPostMix(mixer_callback,NULL);
+    mixer_ok=1;
+    return 0;
+}
+
+void mixer_free()
+{
+    if (mixer_ok)
+    {Mix_SetPostMix(NULL,NULL);}
+    mixer_ok=0;
+    nb_voices=0;
+    last_callback=0;
+}
+
+Mixer_sample *mixer_load(const char *file)
+{
+    Mixer_sample *sample;
+    Mix_Chunk *chunk=Mix_LoadWAV(file);
+    if (chunk==NULL)
+    {
+        fprintf(stderr,"mixer: impossible de charger %s\n",file);
+        return NULL;
+    }
+    sample=(Mixer_sample*)malloc(sizeof(Mixer_sample));
+    if (sample==NULL)
+    {
+        Mix_FreeChunk(chunk);
+        return NULL;
+    }
+    sample->chunk=chunk;
+    return sample;
+}
+
+void mixer_free_sample(Mixer_sample *sample)
+{
+    int v;
+    if (sample==NULL)
+    {return;}
+    SDL_LockAudio();
+    v=0;
+    while (v<nb_voices)
+    {
+          if (voices[v].data==(const Sint16*)sample->chunk->abuf)
+          {voices[v]=voices[--nb_voices];}
+          else
+          {v++;}
+    }
+    SDL_UnlockAudio();
+    Mix_FreeChunk(sample->chunk);
+    free(sample);
+}
+
+void mixer_play(const Mixer_sample *sample,float gain,float pan)
+{
+    Voice vo;
+    int v,best;
+    if (sample==NULL)
+    {return;}
+    if (!mixer_ok)
+    {
+        Mix_PlayChannel(-1,sample->chunk,0);
+        return;
+    }
+    if (gain>1)
+    {gain=1;}
+    else if (gain<0)
+    {gain=0;}
+    if (pan>1)
+    {pan=1;}
+    else if (pan<-1)
+    {pan=-1;}
+    // balance lineaire: au centre les deux cotes restent a plein volume
+    vo.gain[0]=(Sint16)(32767*gain*(pan>0 ? 1-pan : 1));
+    vo.gain[1]=(Sint16)(32767*gain*(pan<0 ? 1+pan : 1));
+    vo.data=(const Sint16*)sample->chunk->abuf;
+    vo.frames=sample->chunk->alen/4;
+    vo.pos=0;
+    vo.queued=prof_now_ns();
+    SDL_LockAudio();
+    if (nb_voices<MIXER_VOICES)
+    {voices[nb_voices++]=vo;}
+    else
+    {
+        // pool plein: on vole la voix la plus proche de sa fin
+        best=0;
+        for (v=1;v<nb_voices;v++)
+        {
+            if (voices[v].frames-voices[v].pos<voices[best].frames-voices[best].pos)
+            {best=v;}
+        }
+        voices[best]=vo;
+    }
+    SDL_UnlockAudio();
+}
+
+float mixer_pan(int xpos,int width)
+{
+    if (width<=0)
+    {return 0;}
+    return 2.0f*xpos/width-1.0f;
+}
+
+// essaie les tailles de buffer de la plus petite a la plus grande. Une taille est stable
+// sans trou et si le callback laisse la moitie du budget libre; parmi elles on garde la
+// latence p99 la plus basse. La sonde s'arrete au callback qui lit la voix: on y ajoute la
+// duree du buffer, que la carte son joue encore avant d'atteindre la fin du son
+int mixer_tune_buffer(const Mixer_sample *probe,FILE *f)
+{
+    static const int sizes[]={256,512,1024,2048,4096};
+    int chosen=0;
+    int s,t,holes,stable;
+    long long budget,mix_max,lat_p99,best=0;
+    double lat_mean;
+    for (s=0;s<5;s++)
+    {
+        // la duree du buffer seule depasse deja la meilleure latence
+        if (chosen!=0 && sizes[s]*1000000000LL/mixer_freq>=best)
+        {break;}
+        if (MLV_change_audio_buffer_size(sizes[s])!=0 || mixer_init()!=0)
+        {continue;}
+        SDL_Delay(200); // le peripherique demarre
+        SDL_LockAudio();
+        underruns=0;
+        prof_clear(PROF_AUDIO_MIX);
+        prof_clear(PROF_AUDIO_LATENCY);
+        SDL_UnlockAudio();
+        for (t=0;t<20;t++)
+        {
+            mixer_play(probe,0,0); // muet, sert seulement a mesurer la latence
+            SDL_Delay(50);
+        }
+        SDL_LockAudio();
+        budget=buffer_frames*1000000000LL/mixer_freq;
+        holes=underruns;
+        mix_max=prof_get(PROF_AUDIO_MIX)->max;
+        lat_p99=prof_percentile(PROF_AUDIO_LATENCY,0.99);
+        lat_mean=prof_get(PROF_AUDIO_LATENCY)->count==0 ? 0 :
+                 (double)prof_get(PROF_AUDIO_LATENCY)->total/prof_get(PROF_AUDIO_LATENCY)->count;
+        SDL_UnlockAudio();
+        lat_mean+=budget;
+        lat_p99+=budget;
+        stable=holes==0 && mix_max<budget/2;
+        if (f!=NULL)
+        {
+            fprintf(f,"audio tune: buffer %4d  underruns %d  mix max %.1f us  latence moy %.2f ms p99 %.2f ms (buffer compris)%s\n",
+                    sizes[s],holes,mix_max/1000.0,lat_mean/1e6,lat_p99/1e6,stable ? "  ok" : "");
+        }
+        if (stable && (chosen==0 || lat_p99<best))
+        {
+            chosen=sizes[s];
+            best=lat_p99;
+        }
+    }
+    if (chosen==0)
+    {chosen=1024;} // taille par defaut de MLV
+    MLV_change_audio_buffer_size(chosen);
+    mixer_init();
+    SDL_LockAudio();
+    underruns=0;
+    prof_clear(PROF_AUDIO_MIX);
+    prof_clear(PROF_AUDIO_LATENCY);
+    SDL_UnlockAudio();
+    return chosen;
+}
+
+int mixer_underruns()
+{
+    return underruns;
+}
+
+int mixer_active_voices()
+{
+    return nb_voices;
+}
+
+void mixer_report(FILE *f)
+{
+    if (!mixer_ok)
+    {
+        fprintf(f,"mixer: inactif\n");
+        return;
+    }
+    fprintf(f,"mixer: %s, %d Hz, buffer %d trames (budget %.2f ms), %d underruns\n",kernel_name,mixer_freq,
+            buffer_frames,buffer_frames*1000.0/mixer_freq,underruns);
+}
@@ -0,0 +1,26 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+#include <SDL/SDL_mixer.h>
+
+// mixeur des effets sonores: remplace les canaux de SDL_mixer par un pool de
+// voix mixees en SSE2/AVX2 (addition saturee) par-dessus le flux de musique
+#define MIXER_VOICES 64
+
+typedef struct
+{
+    Mix_Chunk *chunk;  // deja converti au format de la carte son
+} Mixer_sample;
+
+int mixer_init();  // a appeler apres MLV_init_audio (et apres chaque changement de buffer)
+void mixer_free();
+Mixer_sample *mixer_load(const char *file); // NULL si le fichier ne se charge pas ou si la memoire manque
+void mixer_free_sample(Mixer_sample *sample);
+void mixer_play(const Mixer_sample *sample,float gain,float pan); // pan: -1 gauche .. 1 droite
+float mixer_pan(int xpos,int width);  // pan a partir de la position a l'ecran
+int mixer_tune_buffer(const Mixer_sample *probe,FILE *f); // renvoie la taille retenue
+int mixer_underruns();
+int mixer_active_voices();
+void mixer_report(FILE *f);
+
+#endif
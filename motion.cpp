@@ -0,0 +1,100 @@
+#include "motion.h"
+#include "shots.h"
+
+#define SWAY_MAX 48     // ecart lateral maximal autour du depart, px
+
+unsigned motion_rand(unsigned *state)
+{
+    *state=*state*1103515245u+12345u;
+    return *state>>8;
+}
+
+// melange de la graine: chaque parametre lit ses propres bits
+static unsigned mix(unsigned h)
+{
+    h^=h>>16;
+    h*=0x7feb352du;
+    h^=h>>15;
+    h*=0x846ca68bu;
+    h^=h>>16;
+    return h;
+}
+
+// sinus en 16.16 d'une phase en 1/65536 de tour, par deux paraboles:
+// que des entiers, la meme trajectoire sur toutes les machines
+static int fx_sin(long long phase)
+{
+    int p=(int)(phase&0xffff);
+    int h=p&0x7fff;
+    int s=(h*(32768-h))>>12;
+    return p<32768 ? s : -s;
+}
+
+void path_set(Path *p,unsigned seed)
+{
+    p->t0=-1;
+    p->seed=seed;
+}
+
+void path_launch(Path *p,int tick)
+{
+    p->t0=tick;
+}
+
+int path_launched(const Path *p)
+{
+    return p->t0>=0;
+}
+
+int path_start_x(const Path *p,int xmax)
+{
+    if (xmax<=2*SWAY_MAX)
+    {return xmax/2;}
+    return SWAY_MAX+(int)(mix(p->seed)%(unsigned)(xmax-2*SWAY_MAX));
+}
+
+typedef struct
+{
+    long long v;    // 16.16 px par tick
+    int ty;         // periode de la poussee, ticks
+    long long a;    // amplitude de la poussee, 16.16
+    int tx;         // periode de l'ondulation, ticks
+    long long b;    // amplitude de l'ondulation, px
+    long long phi;
+} Path_params;
+
+// y = v*t + a*sin(2pi*t/Ty): la pente du sinus approche vaut au plus 4/pi,
+// a*8/Ty < v donc l'ennemi ne remonte jamais
+// x = x0 + b*(sin(phi+2pi*t/Tx)-sin(phi))
+static void params(const Path *p,Path_params *k)
+{
+    unsigned h=mix(p->seed^0x9e3779b9u);
+    k->v=FX(1)/2+(h&0x3fff);           // 0.5 a 0.75 px par tick, la moyenne de l'ancien pas
+    k->ty=64+(int)((h>>14)&127);
+    k->a=k->v*k->ty/10;
+    k->tx=128+(int)((h>>21)&255);
+    k->b=SWAY_MAX/2*(long long)((h>>29)+1)/8;
+    k->phi=(long long)(mix(h)&0xffff);
+}
+
+void path_at(const Path *p,int tick,int xmax,int *x,int *y)
+{
+    Path_params k;
+    long long t=tick-p->t0;
+    *x=path_start_x(p,xmax);
+    *y=0;
+    if (p->t0<0 || t<=0)
+    {return;}
+    params(p,&k);
+    *y=1+(int)((k.v*t+((k.a*fx_sin(t*65536/k.ty))>>FX_SHIFT))>>FX_SHIFT);
+    *x+=(int)((k.b*(fx_sin(k.phi+t*65536/k.tx)-fx_sin(k.phi)))>>FX_SHIFT);
+}
+
+void path_bounds(const Path *p,float *vy,float *mx,float *my)
+{
+    Path_params k;
+    params(p,&k);
+    *vy=(float)k.v/FX(1);
+    *mx=(float)(2*k.b+1);   // un pixel pour les arrondis
+    *my=(float)k.a/FX(1)+2;
+}
@@ -0,0 +1,22 @@
+#ifndef MOTION_H
+#define MOTION_H
+
+// trajectoire d'un ennemi: une formule du numero de tick, reglee par une graine.
+// La position a n'importe quel tick se calcule directement, sans rejouer les ticks d'avant.
+typedef struct
+{
+    int t0;         // tick de lancement, -1: pas encore lance
+    unsigned seed;  // fixe l'abscisse de depart, la vitesse et les ondulations
+} Path;
+
+unsigned motion_rand(unsigned *state); // generateur dont tout l'etat tient dans un entier
+
+void path_set(Path *p,unsigned seed);   // ennemi en attente
+void path_launch(Path *p,int tick);
+int path_launched(const Path *p);
+int path_start_x(const Path *p,int xmax);   // abscisse avant le lancement
+void path_at(const Path *p,int tick,int xmax,int *x,int *y); // O(1); avant t0, la position de depart
+// la trajectoire reste a moins de (mx,my) de la droite x=depart, y=1+vy*(tick-t0)
+void path_bounds(const Path *p,float *vy,float *mx,float *my);
+
+#endif
@@ -0,0 +1,401 @@
+#include "particles.h"
+#include "profiler.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <emmintrin.h>
+
+#define DIRECTIONS 256
+
+static float dir_x[DIRECTIONS],dir_y[DIRECTIONS];
+static int dir_ready=0;
+
+int particles_init(Particles *p,int cap,float drag,float gravity,int r,int g,int b)
+{
+    int l,k;
+    cap=(cap+3)&~3;
+    p->x=(float*)_mm_malloc(cap*sizeof(float),16);
+    p->y=(float*)_mm_malloc(cap*sizeof(float),16);
+    p->vx=(float*)_mm_malloc(cap*sizeof(float),16);
+    p->vy=(float*)_mm_malloc(cap*sizeof(float),16);
+    p->life=(float*)_mm_malloc(cap*sizeof(float),16);
+    p->fade=(float*)_mm_malloc(cap*sizeof(float),16);
+    p->count=0;
+    p->cap=cap;
+    p->drag=drag;
+    p->gravity=gravity;
+    // sombre quand la particule s'eteint, presque blanche a la naissance
+    for (l=0;l<PARTICLE_LEVELS;l++)
+    {
+        k=l>PARTICLE_LEVELS*3/4 ? (l-PARTICLE_LEVELS*3/4)*255/(PARTICLE_LEVELS/4) : 0;
+        p->palette[l][0]=(unsigned char)(r*(l+1)/PARTICLE_LEVELS+(255-r)*k/255);
+        p->palette[l][1]=(unsigned char)(g*(l+1)/PARTICLE_LEVELS+(255-g)*k/255);
+        p->palette[l][2]=(unsigned char)(b*(l+1)/PARTICLE_LEVELS+(255-b)*k/255);
+    }
+    if (!dir_ready)
+    {
+        for (k=0;k<DIRECTIONS;k++)
+        {
+            dir_x[k]=cosf(k*6.2831853f/DIRECTIONS);
+            dir_y[k]=sinf(k*6.2831853f/DIRECTIONS);
+        }
+        dir_ready=1;
+    }
+    if (p->x==NULL || p->y==NULL || p->vx==NULL || p->vy==NULL || p->life==NULL || p->fade==NULL)
+    {
+        particles_free(p);
+        return -1;
+    }
+    return 0;
+}
+
+void particles_free(Particles *p)
+{
+    _mm_free(p->x);
+    _mm_free(p->y);
+    _mm_free(p->vx);
+    _mm_free(p->vy);
+    _mm_free(p->life);
+    _mm_free(p->fade);
+    p->x=p->y=p->vx=p->vy=p->life=p->fade=NULL;
+    p->count=p->cap=0;
+}
+
+// entre 0 et 1
+static float rnd(unsigned *seed)
+{
+    *seed=*seed*1103515245u+12345u;
+    return ((*seed>>8)&0xffff)/65536.0f;
+}
+
+// une particule par tour, les tableaux sont remplis d'un bloc a la fin de la pool
+int particles_burst(Particles *p,float x,float y,int n,float speed,int ticks,unsigned *seed)
+{
+    int i,d;
+    float s;
+    if (n>p->cap-p->count)
+    {n=p->cap-p->count;}
+    for (i=p->count;i<p->count+n;i++)
+    {
+        d=(int)(rnd(seed)*DIRECTIONS);
+        s=speed*(0.2f+0.8f*rnd(seed));
+        p->x[i]=x;
+        p->y[i]=y;
+        p->vx[i]=dir_x[d]*s;
+        p->vy[i]=dir_y[d]*s;
+        p->life[i]=1.0f;
+        p->fade[i]=1.0f/(ticks*(0.5f+0.5f*rnd(seed)));
+    }
+    p->count+=n;
+    return n;
+}
+
+int particles_jet(Particles *p,float x,float y,int n,float vx,float vy,float spread,int ticks,unsigned *seed)
+{
+    int i;
+    if (n>p->cap-p->count)
+    {n=p->cap-p->count;}
+    for (i=p->count;i<p->count+n;i++)
+    {
+        p->x[i]=x+(rnd(seed)-0.5f)*spread;
+        p->y[i]=y;
+        p->vx[i]=vx+(rnd(seed)-0.5f)*spread*0.25f;
+        p->vy[i]=vy*(0.5f+rnd(seed));
+        p->life[i]=1.0f;
+        p->fade[i]=1.0f/(ticks*(0.5f+0.5f*rnd(seed)));
+    }
+    p->count+=n;
+    return n;
+}
+
+// de i a la fin, ecrit en w; sert aussi a finir les restes du noyau SIMD
+static int update_range(Particles *p,int i,int w,float fw,float fh)
+{
+    float *X=p->x,*Y=p->y,*VX=p->vx,*VY=p->vy,*L=p->life,*F=p->fade;
+    float x,y,vx,vy,life;
+    for (;i<p->count;i++)
+    {
+        vx=VX[i]*p->drag;
+        vy=VY[i]*p->drag+p->gravity;
+        x=X[i]+vx;
+        y=Y[i]+vy;
+        life=L[i]-F[i];
+        X[w]=x;
+        Y[w]=y;
+        VX[w]=vx;
+        VY[w]=vy;
+        L[w]=life;
+        F[w]=F[i];
+        w+=(life>0.0f && x>=0.0f && x<fw && y>=0.0f && y<fh);
+    }
+    return w;
+}
+
+void particles_update_scalar(Particles *p,int w,int h)
+{
+    p->count=update_range(p,0,0,(float)w,(float)h);
+}
+
+void particles_update(Particles *p,int w,int h)
+{
+    float *X=p->x,*Y=p->y,*VX=p->vx,*VY=p->vy,*L=p->life,*F=p->fade;
+    int n=p->count,i=0,k=0,j,m;
+    __m128 drag=_mm_set1_ps(p->drag);
+    __m128 g=_mm_set1_ps(p->gravity);
+    __m128 zero=_mm_setzero_ps();
+    __m128 fw=_mm_set1_ps((float)w);
+    __m128 fh=_mm_set1_ps((float)h);
+    float tx[4] __attribute__((aligned(16)));
+    float ty[4] __attribute__((aligned(16)));
+    float tvx[4] __attribute__((aligned(16)));
+    float tvy[4] __attribute__((aligned(16)));
+    float tl[4] __attribute__((aligned(16)));
+    float tf[4] __attribute__((aligned(16)));
+    for (;i+4<=n;i+=4)
+    {
+        __m128 vx=_mm_mul_ps(_mm_load_ps(VX+i),drag);
+        __m128 vy=_mm_add_ps(_mm_mul_ps(_mm_load_ps(VY+i),drag),g);
+        __m128 x=_mm_add_ps(_mm_load_ps(X+i),vx);
+        __m128 y=_mm_add_ps(_mm_load_ps(Y+i),vy);
+        __m128 f=_mm_load_ps(F+i);
+        __m128 life=_mm_sub_ps(_mm_load_ps(L+i),f);
+        __m128 inx=_mm_and_ps(_mm_cmpge_ps(x,zero),_mm_cmplt_ps(x,fw));
+        __m128 iny=_mm_and_ps(_mm_cmpge_ps(y,zero),_mm_cmplt_ps(y,fh));
+        m=_mm_movemask_ps(_mm_and_ps(_mm_and_ps(inx,iny),_mm_cmpgt_ps(life,zero)));
+        // comme pour les bals: k<=i, les 4 voies sont ecrites a k sans rien ecraser avant lecture
+        if (m==15)
+        {
+            _mm_storeu_ps(X+k,x);
+            _mm_storeu_ps(Y+k,y);
+            _mm_storeu_ps(VX+k,vx);
+            _mm_storeu_ps(VY+k,vy);
+            _mm_storeu_ps(L+k,life);
+            _mm_storeu_ps(F+k,f);
+            k+=4;
+            continue;
+        }
+        _mm_store_ps(tx,x);
+        _mm_store_ps(ty,y);
+        _mm_store_ps(tvx,vx);
+        _mm_store_ps(tvy,vy);
+        _mm_store_ps(tl,life);
+        _mm_store_ps(tf,f);
+        for (j=0;j<4;j++)
+        {
+            X[k]=tx[j];
+            Y[k]=ty[j];
+            VX[k]=tvx[j];
+            VY[k]=tvy[j];
+            L[k]=tl[j];
+            F[k]=tf[j];
+            k+=(m>>j)&1;
+        }
+    }
+    p->count=update_range(p,i,k,(float)w,(float)h);
+}
+
+// addition saturee octet par octet: le format des pixels n'a pas d'importance
+static inline unsigned add_sat(unsigned a,unsigned b)
+{
+    return (unsigned)_mm_cvtsi128_si32(_mm_adds_epu8(_mm_cvtsi32_si128((int)a),_mm_cvtsi32_si128((int)b)));
+}
+
+static void splat(Particle_layer *l,const unsigned *colors,const Particles *p)
+{
+    const float *X=p->x,*Y=p->y,*L=p->life;
+    unsigned *px=l->pixels;
+    int n=p->count,i,j,cx,cy,x0=l->x0,y0=l->y0,x1=l->x1,y1=l->y1;
+    __m128 levels=_mm_set1_ps((float)PARTICLE_LEVELS);
+    int tx[4] __attribute__((aligned(16)));
+    int ty[4] __attribute__((aligned(16)));
+    int tl[4] __attribute__((aligned(16)));
+    for (i=0;i<n;i+=4)
+    {
+        // les particules d'apres count sont des restes: leurs voies sont ignorees plus bas
+        _mm_store_si128((__m128i*)tx,_mm_cvttps_epi32(_mm_load_ps(X+i)));
+        _mm_store_si128((__m128i*)ty,_mm_cvttps_epi32(_mm_load_ps(Y+i)));
+        _mm_store_si128((__m128i*)tl,_mm_cvttps_epi32(_mm_mul_ps(_mm_load_ps(L+i),levels)));
+        for (j=0;j<4 && i+j<n;j++)
+        {
+            cx=tx[j];
+            cy=ty[j];
+            if ((unsigned)cx>=(unsigned)l->w || (unsigned)cy>=(unsigned)l->h || tl[j]<0)
+            {continue;}
+            px[cy*l->pitch+cx]=add_sat(px[cy*l->pitch+cx],colors[tl[j]<PARTICLE_LEVELS ? tl[j] : PARTICLE_LEVELS-1]);
+            if (cx<x0) {x0=cx;}
+            if (cx>x1) {x1=cx;}
+            if (cy<y0) {y0=cy;}
+            if (cy>y1) {y1=cy;}
+        }
+    }
+    l->x0=x0;
+    l->y0=y0;
+    l->x1=x1;
+    l->y1=y1;
+}
+
+// remet a 0 (transparent) le rectangle dessine
+static void clear_rect(Particle_layer *l)
+{
+    int r;
+    for (r=l->y0;r<=l->y1;r++)
+    {memset(l->pixels+r*l->pitch+l->x0,0,(l->x1-l->x0+1)*sizeof(unsigned));}
+    l->x0=l->w;
+    l->y0=l->h;
+    l->x1=-1;
+    l->y1=-1;
+}
+
+int particles_layer_init(Particle_layer *l,int w,int h)
+{
+    SDL_Surface *s;
+    l->pixels=NULL;
+    l->image=MLV_create_image(w,h);
+    if (l->image==NULL)
+    {return -1;}
+    s=MLV_get_image_data(l->image);
+    if (s->format->BytesPerPixel!=4 || s->format->Amask==0)
+    {
+        MLV_free_image(l->image);
+        l->image=NULL;
+        return -1;
+    }
+    // surface logicielle: les pixels ne bougent pas, on garde le pointeur
+    l->pixels=(unsigned*)s->pixels;
+    l->pitch=s->pitch/4;
+    l->w=w;
+    l->h=h;
+    l->black=SDL_MapRGBA(s->format,0,0,0,255);
+    memset(l->pixels,0,s->pitch*h);
+    l->x0=w;
+    l->y0=h;
+    l->x1=-1;
+    l->y1=-1;
+    return 0;
+}
+
+void particles_layer_free(Particle_layer *l)
+{
+    if (l->image!=NULL)
+    {MLV_free_image(l->image);}
+    l->image=NULL;
+    l->pixels=NULL;
+}
+
+void particles_erase(Particle_layer *l)
+{
+    int r,c,n;
+    unsigned *row;
+    __m128i zero=_mm_setzero_si128();
+    __m128i black=_mm_set1_epi32((int)l->black);
+    if (l->pixels==NULL || l->x1<l->x0)
+    {return;}
+    if (l->image!=NULL)
+    {
+        // les pixels allumes deviennent du noir opaque, le reste reste transparent
+        n=l->x1-l->x0+1;
+        for (r=l->y0;r<=l->y1;r++)
+        {
+            row=l->pixels+r*l->pitch+l->x0;
+            for (c=0;c+4<=n;c+=4)
+            {
+                __m128i v=_mm_loadu_si128((const __m128i*)(row+c));
+                _mm_storeu_si128((__m128i*)(row+c),_mm_andnot_si128(_mm_cmpeq_epi32(v,zero),black));
+            }
+            for (;c<n;c++)
+            {row[c]=row[c] ? l->black : 0;}
+        }
+        MLV_draw_partial_image(l->image,l->x0,l->y0,n,l->y1-l->y0+1,l->x0,l->y0);
+    }
+    clear_rect(l);
+}
+
+void particles_draw(Particle_layer *l,const Particles *p)
+{
+    unsigned colors[PARTICLE_LEVELS];
+    int k;
+    if (l->pixels==NULL)
+    {return;}
+    if (l->image!=NULL)
+    {
+        SDL_Surface *s=MLV_get_image_data(l->image);
+        for (k=0;k<PARTICLE_LEVELS;k++)
+        {colors[k]=SDL_MapRGBA(s->format,p->palette[k][0],p->palette[k][1],p->palette[k][2],255);}
+    }
+    else
+    {
+        for (k=0;k<PARTICLE_LEVELS;k++)
+        {colors[k]=0xff000000u|(p->palette[k][0]<<16)|(p->palette[k][1]<<8)|p->palette[k][2];}
+    }
+    splat(l,colors,p);
+}
+
+void particles_present(Particle_layer *l)
+{
+    if (l->image!=NULL && l->x1>=l->x0)
+    {MLV_draw_partial_image(l->image,l->x0,l->y0,l->x1-l->x0+1,l->y1-l->y0+1,l->x0,l->y0);}
+}
+
+// garde la pool autour de n particules avec des explosions tirees au hasard
+static void bench_fill(Particles *p,int n,unsigned *seed)
+{
+    while (p->count+256<=n)
+    {particles_burst(p,rnd(seed)*1280,rnd(seed)*960,256,6.0f,40,seed);}
+}
+
+void particles_bench(FILE *f,int n,int ticks)
+{
+    Particles ref,simd;
+    Particle_layer l;
+    unsigned seed_ref=1,seed_simd=1;
+    long long t_ref=0,t_simd=0,t_draw=0,t_clear=0,t0;
+    int t,same=1;
+    if (n>PARTICLES_MAX)
+    {n=PARTICLES_MAX;}
+    l.image=NULL;
+    l.w=1280;
+    l.h=960;
+    l.pitch=1280;
+    l.pixels=(unsigned*)calloc(l.w*l.h,sizeof(unsigned));
+    l.x0=l.w;
+    l.y0=l.h;
+    l.x1=-1;
+    l.y1=-1;
+    if (l.pixels==NULL || particles_init(&ref,n,0.96f,0.05f,255,140,40)!=0 || particles_init(&simd,n,0.96f,0.05f,255,140,40)!=0)
+    {
+        fprintf(f,"particles bench: allocation impossible\n");
+        return;
+    }
+    for (t=0;t<ticks;t++)
+    {
+        bench_fill(&ref,n,&seed_ref);
+        bench_fill(&simd,n,&seed_simd);
+        t0=prof_now_ns();
+        particles_update_scalar(&ref,1280,960);
+        t_ref+=prof_now_ns()-t0;
+        t0=prof_now_ns();
+        particles_update(&simd,1280,960);
+        t_simd+=prof_now_ns()-t0;
+        if (ref.count!=simd.count || memcmp(ref.x,simd.x,ref.count*sizeof(float))!=0
+            || memcmp(ref.y,simd.y,ref.count*sizeof(float))!=0 || memcmp(ref.life,simd.life,ref.count*sizeof(float))!=0)
+        {same=0;}
+        t0=prof_now_ns();
+        particles_erase(&l);
+        particles_draw(&l,&simd);
+        t_draw+=prof_now_ns()-t0;
+        // ce que coutait l'effacement de toute la fenetre, au mieux
+        t0=prof_now_ns();
+        memset(l.pixels,0,l.w*l.h*sizeof(unsigned));
+        t_clear+=prof_now_ns()-t0;
+    }
+    fprintf(f,"particles bench: %d particules x %d ticks\n",n,ticks);
+    fprintf(f,"  mise a jour scalaire %9.1f us/tick\n",t_ref/1000.0/ticks);
+    fprintf(f,"  mise a jour sse2     %9.1f us/tick  x%.2f  %s\n",t_simd/1000.0/ticks,
+            t_simd ? (double)t_ref/t_simd : 0.0,same ? "resultats identiques" : "RESULTATS DIFFERENTS");
+    fprintf(f,"  dessin additif       %9.1f us/tick  (effacement complet %.1f us, budget 16600 us)\n",
+            t_draw/1000.0/ticks,t_clear/1000.0/ticks);
+    particles_free(&ref);
+    particles_free(&simd);
+    free(l.pixels);
+}
@@ -0,0 +1,58 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <stdio.h>
+#include <MLV/MLV_all.h>
+
+#define PARTICLES_MAX 131072
+#define PARTICLE_LEVELS 16  // teintes de la palette, de la plus sombre a la plus vive
+
+// particules en SoA: tableaux de float alignes sur 16 octets, compactes en tete
+typedef struct
+{
+    float *x;
+    float *y;
+    float *vx;
+    float *vy;
+    float *life;    // de 1 a la naissance jusqu'a 0
+    float *fade;    // retire a life a chaque tick
+    int count;
+    int cap;
+    float drag;     // multiplie la vitesse a chaque tick
+    float gravity;  // ajoute a vy a chaque tick
+    unsigned char palette[PARTICLE_LEVELS][3];
+} Particles;
+
+int particles_init(Particles *p,int cap,float drag,float gravity,int r,int g,int b);
+void particles_free(Particles *p);
+
+// emission par lots: n particules d'un coup, tirees avec le generateur *seed
+int particles_burst(Particles *p,float x,float y,int n,float speed,int ticks,unsigned *seed); // dans toutes les directions
+int particles_jet(Particles *p,float x,float y,int n,float vx,float vy,float spread,int ticks,unsigned *seed); // autour de (vx,vy)
+
+// avance, fait palir et retire en un seul passage celles qui sont eteintes ou hors de [0,w[x[0,h[
+void particles_update(Particles *p,int w,int h);
+void particles_update_scalar(Particles *p,int w,int h);
+
+// tampon hors ecran de la taille de la fenetre: les particules s'y ajoutent
+// (addition saturee par octet) puis seul le rectangle touche est colle a l'ecran
+typedef struct
+{
+    MLV_Image *image;
+    unsigned *pixels;
+    int pitch;          // en pixels
+    int w,h;
+    unsigned black;     // noir opaque dans le format de l'image
+    unsigned colors[PARTICLE_LEVELS];
+    int x0,y0,x1,y1;    // rectangle dessine a cette image, vide si x1<x0
+} Particle_layer;
+
+int particles_layer_init(Particle_layer *l,int w,int h);
+void particles_layer_free(Particle_layer *l);
+void particles_erase(Particle_layer *l);    // avant les sprites: efface a l'ecran les pixels de l'image precedente
+void particles_draw(Particle_layer *l,const Particles *p);
+void particles_present(Particle_layer *l);  // apres les sprites
+
+void particles_bench(FILE *f,int n,int ticks); // noyau SIMD contre la reference scalaire, plus le dessin
+
+#endif
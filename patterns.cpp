@@ -0,0 +1,128 @@
+#include "patterns.h"
+
+#include <math.h>
+#include <string.h>
+
+// les emetteurs: ajouter une ligne suffit pour un nouveau motif
+static const Pattern patterns[]=
+{
+    // nom       type            bals  vitesse        ouverture  rotation
+    {"aimed",   PATTERN_AIMED,   1,   FX(1),          0,         0},
+    {"fan",     PATTERN_FAN,     5,   FX(3)/2,        40,        0},
+    {"ring",    PATTERN_RING,    16,  FX(1),          0,         5},
+    {"spiral",  PATTERN_SPIRAL,  6,   FX(5)/4,        0,         11},
+    {"wave",    PATTERN_WAVE,    9,   FX(1),          24,        16},
+    {"boss",    PATTERN_RING,    64,  FX(3)/2,        0,         3}
+};
+
+// programme de tir: une salve par cycle
+static const char *schedule[]=
+{
+    "aimed","aimed","aimed","fan","aimed","aimed","wave","aimed","aimed","ring","aimed","spiral",
+    "aimed","aimed","boss"
+};
+
+#define NB_PATTERNS (int)(sizeof(patterns)/sizeof(patterns[0]))
+#define NB_SCHEDULE (int)(sizeof(schedule)/sizeof(schedule[0]))
+
+static int fx_cos[256]; // 16.16
+static int fx_sin[256];
+static const Pattern *schedule_patterns[NB_SCHEDULE];
+
+void patterns_init()
+{
+    int a,s;
+    for (a=0;a<256;a++)
+    {
+        fx_cos[a]=(int)floor(cos(a*M_PI/128)*FX(1)+0.5);
+        fx_sin[a]=(int)floor(sin(a*M_PI/128)*FX(1)+0.5);
+    }
+    for (s=0;s<NB_SCHEDULE;s++)
+    {
+        schedule_patterns[s]=pattern_find(schedule[s]);
+        if (schedule_patterns[s]==NULL)
+        {schedule_patterns[s]=&patterns[0];}
+    }
+}
+
+const Pattern *pattern_find(const char *name)
+{
+    int i;
+    for (i=0;i<NB_PATTERNS;i++)
+    {
+        if (strcmp(patterns[i].name,name)==0)
+        {return &patterns[i];}
+    }
+    return NULL;
+}
+
+const Pattern *pattern_next(int volley)
+{
+    return schedule_patterns[volley%NB_SCHEDULE];
+}
+
+int pattern_emit(Shot_pool *p,const Pattern *pat,int x,int y,int target_x,int target_y,int phase)
+{
+    int n=pat->count;
+    int base=p->count;
+    int *X=p->x+base,*Y=p->y+base,*VX=p->vx+base,*VY=p->vy+base;
+    int dx=target_x-x;
+    int dy=target_y-y;
+    int aim,a,j;
+    if (n>p->cap-base)
+    {n=p->cap-base;}
+    if (n<=0)
+    {return 0;}
+    // le seul calcul couteux est fait une fois par salve, pas par bal
+    aim=(int)floor(atan2((double)dy,(double)dx)*128/M_PI+0.5);
+    for (j=0;j<n;j++)
+    {
+        X[j]=FX(x);
+        Y[j]=FX(y);
+    }
+    switch (pat->type)
+    {
+        case PATTERN_AIMED:
+            for (j=0;j<n;j++)
+            {
+                VX[j]=dy>0 ? (int)((long long)dx*pat->speed/dy) : 0;
+                VY[j]=pat->speed;
+            }
+            break;
+        case PATTERN_FAN:
+            for (j=0;j<n;j++)
+            {
+                a=(aim-pat->spread/2+(n>1 ? j*pat->spread/(n-1) : pat->spread/2))&255;
+                VX[j]=(int)((long long)fx_cos[a]*pat->speed>>FX_SHIFT);
+                VY[j]=(int)((long long)fx_sin[a]*pat->speed>>FX_SHIFT);
+            }
+            break;
+        case PATTERN_RING:
+            for (j=0;j<n;j++)
+            {
+                a=(j*256/n+phase*pat->turn)&255;
+                VX[j]=(int)((long long)fx_cos[a]*pat->speed>>FX_SHIFT);
+                VY[j]=(int)((long long)fx_sin[a]*pat->speed>>FX_SHIFT);
+            }
+            break;
+        case PATTERN_SPIRAL:
+            for (j=0;j<n;j++)
+            {
+                a=((phase*n+j)*pat->turn)&255;
+                VX[j]=(int)((long long)fx_cos[a]*pat->speed>>FX_SHIFT);
+                VY[j]=(int)((long long)fx_sin[a]*pat->speed>>FX_SHIFT);
+            }
+            break;
+        case PATTERN_WAVE:
+            for (j=0;j<n;j++)
+            {
+                // 64 = droit vers le bas
+                a=(64+(int)((long long)fx_sin[(phase*pat->turn+j*256/n)&255]*pat->spread>>(FX_SHIFT+1)))&255;
+                VX[j]=(int)((long long)fx_cos[a]*pat->speed>>FX_SHIFT);
+                VY[j]=(int)((long long)fx_sin[a]*pat->speed>>FX_SHIFT);
+            }
+            break;
+    }
+    p->count+=n;
+    return n;
+}
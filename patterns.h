@@ -0,0 +1,34 @@
+#ifndef PATTERNS_H
+#define PATTERNS_H
+
+#include "shots.h"
+
+// formes de salves
+enum
+{
+    PATTERN_AIMED,   // chute de 1 px/tick vers la cible (le tir historique)
+    PATTERN_FAN,     // eventail centre sur la cible
+    PATTERN_RING,    // cercle complet, tourne a chaque salve
+    PATTERN_SPIRAL,  // bras de spirale: chaque bal tourne de plus que la precedente
+    PATTERN_WAVE     // rideau vers le bas qui ondule d'une salve a l'autre
+};
+
+// un emetteur decrit en donnees: les angles sont en 1/256 de tour
+typedef struct
+{
+    const char *name;
+    int type;
+    int count;   // bals par salve
+    int speed;   // px par tick, 16.16
+    int spread;  // ouverture (fan, wave)
+    int turn;    // rotation par salve ou par bal (ring, spiral, wave)
+} Pattern;
+
+void patterns_init();
+const Pattern *pattern_find(const char *name);
+const Pattern *pattern_next(int volley); // salve suivante dans le programme de tir
+
+// ecrit la salve directement dans la pool, sans allocation; renvoie le nombre de bals emises
+int pattern_emit(Shot_pool *p,const Pattern *pat,int x,int y,int target_x,int target_y,int phase);
+
+#endif
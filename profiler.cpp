@@ -0,0 +1,196 @@
+#include "profiler.h"
+
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
+
+static const char *prof_names[PROF_NB_SECTIONS]=
+{
+    "audio mix / buffer",
+    "audio play->buffer",
+    "input press->tick",
+    "input press->display",
+    "sim tick",
+    "render"
+};
+
+static Prof_stat prof_stats[PROF_NB_SECTIONS];
+
+// sonde entree->affichage: appui en attente d'un effet, puis effet en
+// attente du prochain MLV_actualise_window
+#define PROBE_KEYS 8
+static long long probe_pending[PROBE_KEYS];
+static int probe_early[PROBE_KEYS]; // le tick affiche juste apres l'appui a ete calcule avant lui
+static long long probe_shown[PROBE_KEYS];
+
+long long prof_now_ns()
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if (freq.QuadPart==0)
+    {QueryPerformanceFrequency(&freq);}
+    QueryPerformanceCounter(&t);
+    // decoupe pour ne pas deborder ni perdre en precision
+    return (t.QuadPart/freq.QuadPart)*1000000000LL
+           +(t.QuadPart%freq.QuadPart)*1000000000LL/freq.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC,&t);
+    return (long long)t.tv_sec*1000000000LL+t.tv_nsec;
+#endif
+}
+
+long long prof_peak_memory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS m;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(),&m,sizeof(m)))
+    {return 0;}
+    return (long long)m.PeakWorkingSetSize;
+#else
+    struct rusage u;
+    if (getrusage(RUSAGE_SELF,&u)!=0)
+    {return 0;}
+    return (long long)u.ru_maxrss*1024;
+#endif
+}
+
+static int prof_bucket(long long ns)
+{
+    int b=0;
+    while (ns>1 && b<PROF_BUCKETS-1)
+    {
+          ns>>=1;
+          b++;
+    }
+    return b;
+}
+
+void prof_add(int section,long long ns)
+{
+    Prof_stat *s=&prof_stats[section];
+    if (ns<0)
+    {ns=0;}
+    if (s->count==0 || ns<s->min)
+    {s->min=ns;}
+    if (ns>s->max)
+    {s->max=ns;}
+    s->count+=1;
+    s->total+=ns;
+    s->hist[prof_bucket(ns)]+=1;
+}
+
+const Prof_stat *prof_get(int section)
+{
+    return &prof_stats[section];
+}
+
+// borne haute du bucket qui contient le percentile p (0..1)
+long long prof_percentile(int section,double p)
+{
+    const Prof_stat *s=&prof_stats[section];
+    long long seen=0;
+    long long want=(long long)(s->count*p);
+    int b;
+    for (b=0;b<PROF_BUCKETS;b++)
+    {
+        seen+=s->hist[b];
+        if (seen>want)
+        {
+            long long top=2LL<<b;
+            return top<s->max ? top : s->max;
+        }
+    }
+    return s->max;
+}
+
+void prof_reset()
+{
+    memset(prof_stats,0,sizeof(prof_stats));
+}
+
+void prof_clear(int section)
+{
+    memset(&prof_stats[section],0,sizeof(Prof_stat));
+}
+
+void probe_press(int key,long long press_time)
+{
+    prof_add(PROF_INPUT_TICK,prof_now_ns()-press_time);
+    probe_pending[key]=press_time;
+    probe_early[key]=1;
+}
+
+void probe_tick(int key,int held,int effect)
+{
+    if (probe_pending[key]==0)
+    {return;}
+    if (probe_early[key])
+    {
+        // un tick de la simulation est toujours en vol pendant le dessin
+        probe_early[key]=0;
+        return;
+    }
+    if (effect)
+    {
+        probe_shown[key]=probe_pending[key];
+        probe_pending[key]=0;
+    }
+    else if (!held)
+    {probe_pending[key]=0;}
+}
+
+void probe_present()
+{
+    long long now=prof_now_ns();
+    int k;
+    for (k=0;k<PROBE_KEYS;k++)
+    {
+        if (probe_shown[k]!=0)
+        {
+            prof_add(PROF_INPUT_DISPLAY,now-probe_shown[k]);
+            probe_shown[k]=0;
+        }
+    }
+}
+
+void prof_report_histogram(FILE *f,int section)
+{
+    const Prof_stat *s=&prof_stats[section];
+    int b,n;
+    if (s->count==0)
+    {return;}
+    fprintf(f,"%s:\n",prof_names[section]);
+    for (b=0;b<PROF_BUCKETS;b++)
+    {
+        if (s->hist[b]==0)
+        {continue;}
+        fprintf(f,"  %9.3f - %9.3f ms %8lld ",(b==0 ? 0 : 1LL<<b)/1e6,(2LL<<b)/1e6,s->hist[b]);
+        for (n=0;n<s->hist[b]*50/s->count;n++)
+        {fputc('#',f);}
+        fputc('\n',f);
+    }
+}
+
+void prof_report(FILE *f)
+{
+    int i;
+    fprintf(f,"%-24s %10s %10s %10s %10s %10s %10s %10s %10s\n","section","count","mean us","min us",
+            "p50 us","p95 us","p99 us","max us","total ms");
+    for (i=0;i<PROF_NB_SECTIONS;i++)
+    {
+        const Prof_stat *s=&prof_stats[i];
+        if (s->count==0)
+        {continue;}
+        fprintf(f,"%-24s %10lld %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",prof_names[i],s->count,
+                s->total/1000.0/s->count,s->min/1000.0,prof_percentile(i,0.5)/1000.0,
+                prof_percentile(i,0.95)/1000.0,prof_percentile(i,0.99)/1000.0,
+                s->max/1000.0,s->total/1000000.0);
+    }
+}
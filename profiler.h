@@ -0,0 +1,47 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdio.h>
+
+// sections mesurees; chaque section n'est alimentee que par un seul thread
+enum
+{
+    PROF_AUDIO_MIX,     // duree du callback audio, par buffer
+    PROF_AUDIO_LATENCY, // de mixer_play au buffer qui contient le debut du son
+    PROF_INPUT_TICK,    // de l'appui au tick qui le consomme
+    PROF_INPUT_DISPLAY, // de l'appui au MLV_actualise_window qui montre son effet
+    PROF_SIM_TICK,      // un tick de simulation, sur son thread
+    PROF_RENDER,        // dessin d'un tick fige jusqu'a MLV_actualise_window
+    PROF_NB_SECTIONS
+};
+
+#define PROF_BUCKETS 48 // histogramme en puissances de 2 (ns)
+
+typedef struct
+{
+    long long count;
+    long long total;    // ns
+    long long min;
+    long long max;
+    long long hist[PROF_BUCKETS];
+} Prof_stat;
+
+long long prof_now_ns(); // horloge haute resolution, monotone
+long long prof_peak_memory(); // octets, pic de memoire du processus depuis son lancement
+void prof_add(int section,long long ns);
+const Prof_stat *prof_get(int section);
+long long prof_percentile(int section,double p);
+void prof_reset();
+void prof_clear(int section);
+void prof_report(FILE *f);
+void prof_report_histogram(FILE *f,int section);
+
+// sonde de latence entree->affichage (thread du jeu uniquement)
+void probe_press(int key,long long press_time); // le tick consomme un appui
+// pour chaque tick affiche: la touche y etait tenue, son effet y est visible. L'appui
+// n'attend un effet que tant que la touche reste tenue: relachee sans effet (avion au
+// bord, tir en recharge), il est oublie
+void probe_tick(int key,int held,int effect);
+void probe_present();        // juste apres MLV_actualise_window
+
+#endif
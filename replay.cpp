@@ -0,0 +1,706 @@
+#include "replay.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <emmintrin.h>
+#include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
+#include <SDL/SDL_timer.h>
+
+#define REPLAY_MAGIC 0x324c5052u   // "RPL2"
+#define REPLAY_CHECKS_MAGIC 0x31435052u    // "RPC1"
+
+// ------------------------------------------------------------------ compression des images cles
+
+// l'etat est surtout fait de zeros (bals et predictions inutilisees apres game_trim):
+// des mots de 32 bits en suites (zeros, litteraux), chaque longueur en varint
+static unsigned char *put_varint(unsigned char *p,unsigned v)
+{
+    while (v>=0x80)
+    {
+        *p++=(unsigned char)(v|0x80);
+        v>>=7;
+    }
+    *p++=(unsigned char)v;
+    return p;
+}
+
+static const unsigned char *get_varint(const unsigned char *p,const unsigned char *end,unsigned *v)
+{
+    int shift=0;
+    *v=0;
+    while (p<end && shift<32)
+    {
+        *v|=(unsigned)(*p&0x7f)<<shift;
+        if ((*p++&0x80)==0)
+        {return p;}
+        shift+=7;
+    }
+    return NULL;
+}
+
+static int pack(const unsigned *w,int n,unsigned char *out)
+{
+    unsigned char *p=out;
+    int i=0,z,l;
+    while (i<n)
+    {
+        for (z=0;i+z<n && w[i+z]==0;z++);
+        i+=z;
+        // une suite de litteraux s'arrete a deux zeros: un zero isole coute moins cher en litteral
+        for (l=0;i+l<n && (w[i+l]!=0 || (i+l+1<n && w[i+l+1]!=0));l++);
+        p=put_varint(p,(unsigned)z);
+        p=put_varint(p,(unsigned)l);
+        memcpy(p,w+i,l*sizeof(unsigned));
+        p+=l*sizeof(unsigned);
+        i+=l;
+    }
+    return (int)(p-out);
+}
+
+static int unpack(const unsigned char *p,int size,unsigned *w,int n)
+{
+    const unsigned char *end=p+size;
+    unsigned z,l;
+    int i=0;
+    while (p<end)
+    {
+        p=get_varint(p,end,&z);
+        if (p==NULL)
+        {return -1;}
+        p=get_varint(p,end,&l);
+        if (p==NULL || z>(unsigned)(n-i) || l>(unsigned)(n-i)-z || (int)(l*sizeof(unsigned))>end-p)
+        {return -1;}
+        memset(w+i,0,z*sizeof(unsigned));
+        i+=z;
+        memcpy(w+i,p,l*sizeof(unsigned));
+        i+=l;
+        p+=l*sizeof(unsigned);
+    }
+    return i==n ? 0 : -1;
+}
+
+#define PACK_MAX ((int)(sizeof(Game)+sizeof(Game)/4+16)) // pire cas: tout en litteraux
+
+// copie nettoyee de l'etat, compressee dans buf (PACK_MAX octets)
+static int pack_game(const Game *g,Game *copy,unsigned char *buf)
+{
+    game_save(copy,g);
+    game_trim(copy);
+    return pack((const unsigned*)copy,sizeof(Game)/sizeof(unsigned),buf);
+}
+
+static int add_key(Replay_key **keys,int *nb,int *cap,int tick,const unsigned char *data,int size)
+{
+    Replay_key *k;
+    if (*nb==*cap)
+    {
+        k=(Replay_key*)realloc(*keys,(*cap*2+16)*sizeof(Replay_key));
+        if (k==NULL)
+        {return -1;}
+        *keys=k;
+        *cap=*cap*2+16;
+    }
+    k=&(*keys)[*nb];
+    k->tick=tick;
+    k->size=size;
+    k->data=(unsigned char*)malloc(size);
+    if (k->data==NULL)
+    {return -1;}
+    memcpy(k->data,data,size);
+    *nb+=1;
+    return 0;
+}
+
+static const Replay_key *find_key(const Replay_key *keys,int nb,int tick)
+{
+    int lo=0,hi=nb-1,mid;
+    if (nb==0 || keys[0].tick>tick)
+    {return NULL;}
+    while (lo<hi)
+    {
+        mid=(lo+hi+1)/2;
+        if (keys[mid].tick<=tick)
+        {lo=mid;}
+        else
+        {hi=mid-1;}
+    }
+    return &keys[lo];
+}
+
+// ------------------------------------------------------------------ ecriture
+
+// empreinte de la version: un replay ne se rejoue a l'identique que par le meme jeu
+static unsigned build_hash()
+{
+    static const char build[]=__DATE__ " " __TIME__;
+    unsigned h=2166136261u,layout[4];
+    unsigned i;
+    layout[0]=(unsigned)sizeof(Game);
+    layout[1]=GAME_TICK_MS;
+    layout[2]=INPUT_STEPS;
+    layout[3]=NB_ALIENS;
+    for (i=0;i<sizeof(build)-1;i++)
+    {h=(h^(unsigned char)build[i])*16777619u;}
+    for (i=0;i<sizeof(layout);i++)
+    {h=(h^((const unsigned char*)layout)[i])*16777619u;}
+    return h;
+}
+
+// deux fichiers par partie: les entrees (le replay) et, a cote, les controles:
+// l'empreinte de l'etat avant chaque tick et l'etat complet toutes les REPLAY_KEYFRAME
+typedef struct
+{
+    FILE *f;
+    unsigned char *cur;     // bloc en cours de remplissage
+    int size,cap;
+} Stream;
+
+// blocs pleins en attente d'ecriture, file un producteur / un consommateur sans verrou
+#define REPLAY_QUEUE 64
+
+typedef struct
+{
+    FILE *f;
+    unsigned char *data;
+    int size;
+} Chunk;
+
+static Chunk queue[REPLAY_QUEUE];
+static unsigned queue_head=0;
+static unsigned queue_tail=0;
+static SDL_Thread *writer=NULL;
+static SDL_sem *writer_wake=NULL;
+static int writer_quit=0;
+static int writer_failed=0;
+static Stream inputs_out;
+static Stream checks_out;
+static Game *check_copy=NULL;           // pour compresser l'etat sans toucher au jeu
+static unsigned char *check_buf=NULL;
+static int rec_tick;        // ticks deja codes
+static int rec_last;        // tick du dernier evenement
+
+static void write_chunk(Chunk *c)
+{
+    if (fwrite(c->data,1,c->size,c->f)!=(size_t)c->size)
+    {__atomic_store_n(&writer_failed,1,__ATOMIC_RELAXED);}
+    free(c->data);
+}
+
+static int SDLCALL writer_loop(void *data)
+{
+    unsigned tail;
+    for (;;)
+    {
+        SDL_SemWait(writer_wake);
+        tail=__atomic_load_n(&queue_tail,__ATOMIC_RELAXED);
+        while (tail!=__atomic_load_n(&queue_head,__ATOMIC_ACQUIRE))
+        {
+            write_chunk(&queue[tail%REPLAY_QUEUE]);
+            __atomic_store_n(&queue_tail,++tail,__ATOMIC_RELEASE);
+        }
+        if (__atomic_load_n(&writer_quit,__ATOMIC_ACQUIRE))
+        {break;}
+    }
+    return 0;
+}
+
+// confie le bloc au thread; file pleine: le bloc grandit et partira au suivant
+static void flush_chunk(Stream *s,int wait)
+{
+    unsigned head=__atomic_load_n(&queue_head,__ATOMIC_RELAXED);
+    Chunk c;
+    c.f=s->f;
+    c.data=s->cur;
+    c.size=s->size;
+    if (writer==NULL)
+    {write_chunk(&c);}
+    else
+    {
+        while (head-__atomic_load_n(&queue_tail,__ATOMIC_ACQUIRE)==REPLAY_QUEUE)
+        {
+            if (!wait)
+            {return;}
+            SDL_Delay(1);
+        }
+        queue[head%REPLAY_QUEUE]=c;
+        __atomic_store_n(&queue_head,head+1,__ATOMIC_RELEASE);
+        SDL_SemPost(writer_wake);
+    }
+    s->cap=REPLAY_CHUNK;
+    s->cur=(unsigned char*)malloc(s->cap);
+    s->size=0;
+}
+
+// place pour n octets dans le bloc en cours
+static unsigned char *reserve(Stream *s,int n)
+{
+    unsigned char *p;
+    int cap=s->cap;
+    if (s->cur==NULL || s->size+n>cap)
+    {
+        while (s->size+n>cap)
+        {cap*=2;}
+        p=(unsigned char*)realloc(s->cur,cap);
+        if (p==NULL)
+        {
+            writer_failed=1;
+            return NULL;
+        }
+        s->cur=p;
+        s->cap=cap;
+    }
+    return s->cur+s->size;
+}
+
+static void commit(Stream *s,int n)
+{
+    s->size+=n;
+    if (s->size>=REPLAY_CHUNK)
+    {flush_chunk(s,0);}
+}
+
+static void put_event(int delta,unsigned mask,const Input_tick *t)
+{
+    unsigned char *p=reserve(&inputs_out,2*5+2*KEY_NB),*q;
+    int k;
+    if (p==NULL)
+    {return;}
+    q=put_varint(p,(unsigned)delta);
+    q=put_varint(q,mask);
+    for (k=0;t!=NULL && k<KEY_NB;k++)
+    {
+        if ((t->pressed|t->released)&KEY_BIT(k))
+        {*q++=t->held[k];}
+        if (t->pressed&KEY_BIT(k))
+        {*q++=t->age[k];}
+    }
+    commit(&inputs_out,(int)(q-p));
+}
+
+static void put_check(const Game *g)
+{
+    unsigned char *p;
+    unsigned h;
+    int size;
+    if (g->tick%REPLAY_KEYFRAME==0)
+    {
+        size=pack_game(g,check_copy,check_buf);
+        p=reserve(&checks_out,sizeof(int)+size);
+        if (p==NULL)
+        {return;}
+        memcpy(p,&size,sizeof(int));
+        memcpy(p+sizeof(int),check_buf,size);
+        commit(&checks_out,sizeof(int)+size);
+    }
+    h=game_hash(g);
+    p=reserve(&checks_out,sizeof(unsigned));
+    if (p==NULL)
+    {return;}
+    memcpy(p,&h,sizeof(unsigned));
+    commit(&checks_out,sizeof(unsigned));
+}
+
+static int stream_open(Stream *s,const char *path,const unsigned *head,int n)
+{
+    s->f=fopen(path,"wb");
+    s->cap=REPLAY_CHUNK;
+    s->cur=(unsigned char*)malloc(s->cap);
+    if (s->f==NULL || s->cur==NULL)
+    {return -1;}
+    memcpy(s->cur,head,n*sizeof(unsigned));
+    s->size=n*sizeof(unsigned);
+    return 0;
+}
+
+static int stream_close(Stream *s)
+{
+    int failed=0;
+    if (s->f!=NULL && fclose(s->f)!=0)
+    {failed=1;}
+    free(s->cur);
+    memset(s,0,sizeof(Stream));
+    return failed;
+}
+
+static void checks_path(char *dst,const char *path)
+{
+    strcpy(dst,path);
+    strcat(dst,".chk");
+}
+
+int replay_open(const char *path,int w,int h,unsigned seed)
+{
+    unsigned head[5];
+    char *chk=(char*)malloc(strlen(path)+5);
+    int ok;
+    replay_close();
+    head[0]=REPLAY_MAGIC;
+    head[1]=build_hash();
+    head[2]=seed;
+    head[3]=(unsigned)w;
+    head[4]=(unsigned)h;
+    ok=chk!=NULL && stream_open(&inputs_out,path,head,5)==0;
+    head[0]=REPLAY_CHECKS_MAGIC;
+    if (ok)
+    {
+        checks_path(chk,path);
+        check_copy=(Game*)_mm_malloc(sizeof(Game),32);
+        check_buf=(unsigned char*)malloc(PACK_MAX);
+        ok=stream_open(&checks_out,chk,head,2)==0 && check_copy!=NULL && check_buf!=NULL;
+    }
+    free(chk);
+    rec_tick=0;
+    rec_last=0;
+    queue_head=queue_tail=0;
+    writer_quit=0;
+    writer_failed=0;
+    if (!ok)
+    {
+        replay_close();
+        return -1;
+    }
+    writer_wake=SDL_CreateSemaphore(0);
+    if (writer_wake!=NULL)
+    {writer=SDL_CreateThread(writer_loop,NULL);}
+    return 0;
+}
+
+// un evenement seulement quand une touche change: les autres ticks se deduisent
+// (touche enfoncee tout le tick ou pas du tout)
+void replay_write(const Input_tick *t,const Game *g)
+{
+    unsigned change=t->pressed|t->released;
+    if (inputs_out.f==NULL)
+    {return;}
+    if (change!=0)
+    {
+        put_event(rec_tick-rec_last,t->pressed|(t->released<<KEY_NB)|((t->down&change)<<(2*KEY_NB)),t);
+        rec_last=rec_tick;
+    }
+    put_check(g);
+    rec_tick+=1;
+}
+
+int replay_close()
+{
+    int failed;
+    if (inputs_out.f!=NULL && checks_out.f!=NULL)
+    {
+        put_event(rec_tick-rec_last,0,NULL); // fin de partie
+        flush_chunk(&inputs_out,1);
+        flush_chunk(&checks_out,1);
+    }
+    if (writer!=NULL)
+    {
+        __atomic_store_n(&writer_quit,1,__ATOMIC_RELEASE);
+        SDL_SemPost(writer_wake);
+        SDL_WaitThread(writer,NULL);
+        writer=NULL;
+    }
+    if (writer_wake!=NULL)
+    {SDL_DestroySemaphore(writer_wake);}
+    writer_wake=NULL;
+    failed=inputs_out.f==NULL || writer_failed;
+    failed|=stream_close(&inputs_out);
+    failed|=stream_close(&checks_out);
+    _mm_free(check_copy);
+    free(check_buf);
+    check_copy=NULL;
+    check_buf=NULL;
+    return failed ? -1 : 0;
+}
+
+// ------------------------------------------------------------------ fichier
+
+static unsigned char *read_file(const char *path,long *size)
+{
+    FILE *f=fopen(path,"rb");
+    unsigned char *buf=NULL;
+    if (f==NULL)
+    {return NULL;}
+    fseek(f,0,SEEK_END);
+    *size=ftell(f);
+    fseek(f,0,SEEK_SET);
+    if (*size>=0)
+    {buf=(unsigned char*)malloc(*size+1);}
+    if (buf!=NULL && *size>0 && fread(buf,*size,1,f)!=1)
+    {
+        free(buf);
+        buf=NULL;
+    }
+    fclose(f);
+    return buf;
+}
+
+// les controles sont facultatifs: sans eux le replay se joue, sans verification
+static void load_checks(Replay *r,const char *path)
+{
+    char *chk=(char*)malloc(strlen(path)+5);
+    unsigned char *buf=NULL;
+    const unsigned char *p,*end;
+    unsigned head[2];
+    long size=0;
+    int size_key,cap=0,cap_checks=0,tick;
+    if (chk!=NULL)
+    {
+        checks_path(chk,path);
+        buf=read_file(chk,&size);
+        free(chk);
+    }
+    if (buf==NULL || size<(long)sizeof(head))
+    {
+        free(buf);
+        return;
+    }
+    memcpy(head,buf,sizeof(head));
+    p=buf+sizeof(head);
+    end=buf+size;
+    // un fichier coupe (partie interrompue) vaut jusqu'au dernier tick complet
+    for (tick=0;head[0]==REPLAY_CHECKS_MAGIC && tick<r->nb_ticks;tick++)
+    {
+        if (tick%REPLAY_KEYFRAME==0)
+        {
+            if (end-p<(long)sizeof(int))
+            {break;}
+            memcpy(&size_key,p,sizeof(int));
+            if (size_key<=0 || size_key>PACK_MAX || end-p-(long)sizeof(int)<size_key
+                || add_key(&r->checks,&r->nb_checks,&cap_checks,tick,p+sizeof(int),size_key)!=0)
+            {break;}
+            p+=sizeof(int)+size_key;
+        }
+        if (end-p<(long)sizeof(unsigned))
+        {break;}
+        if (tick==cap)
+        {
+            cap=cap*2+4096;
+            r->hashes=(unsigned*)realloc(r->hashes,cap*sizeof(unsigned));
+            if (r->hashes==NULL)
+            {break;}
+        }
+        memcpy(&r->hashes[tick],p,sizeof(unsigned));
+        p+=sizeof(unsigned);
+        r->nb_hashes=tick+1;
+    }
+    if (r->hashes==NULL)
+    {r->nb_hashes=0;}
+    free(buf);
+}
+
+int replay_load(Replay *r,const char *path)
+{
+    unsigned head[5],delta,mask,change;
+    unsigned char *buf;
+    const unsigned char *p,*end;
+    Input_tick *t;
+    long size=0;
+    int tick=0,cap=0,k,last=0,ok;
+    unsigned down=0;
+    memset(r,0,sizeof(Replay));
+    r->diverged=-1;
+    buf=read_file(path,&size);
+    ok=buf!=NULL && size>=(long)sizeof(head);
+    if (ok)
+    {
+        memcpy(head,buf,sizeof(head));
+        ok=head[0]==REPLAY_MAGIC;
+        r->seed=head[2];
+        r->w=(int)head[3];
+        r->h=(int)head[4];
+        r->same_build=head[1]==build_hash();
+        r->bytes=size;
+    }
+    p=buf+sizeof(head);
+    end=buf+size;
+    // les ticks entre deux evenements gardent les touches enfoncees de bout en bout
+    while (ok)
+    {
+        p=get_varint(p,end,&delta);
+        if (p!=NULL)
+        {p=get_varint(p,end,&mask);}
+        if (p==NULL || delta>(1u<<28) || (tick>0 && delta==0 && mask!=0))
+        {
+            ok=0;
+            break;
+        }
+        last+=delta;
+        if (last>=cap)
+        {
+            cap=last*2+4096;
+            t=(Input_tick*)realloc(r->inputs,cap*sizeof(Input_tick));
+            if (t==NULL)
+            {
+                ok=0;
+                break;
+            }
+            r->inputs=t;
+        }
+        for (;tick<last;tick++)
+        {
+            t=&r->inputs[tick];
+            memset(t,0,sizeof(Input_tick));
+            t->down=(unsigned char)down;
+            for (k=0;k<KEY_NB;k++)
+            {t->held[k]=(down&KEY_BIT(k)) ? INPUT_STEPS : 0;}
+        }
+        if (mask==0)
+        {break;}
+        t=&r->inputs[tick];
+        memset(t,0,sizeof(Input_tick));
+        t->pressed=(unsigned char)(mask&((1u<<KEY_NB)-1));
+        t->released=(unsigned char)((mask>>KEY_NB)&((1u<<KEY_NB)-1));
+        change=t->pressed|t->released;
+        down=(down&~change)|((mask>>(2*KEY_NB))&change);
+        t->down=(unsigned char)down;
+        for (k=0;k<KEY_NB;k++)
+        {
+            if (change&KEY_BIT(k))
+            {
+                if (p>=end)
+                {ok=0;}
+                else
+                {t->held[k]=*p++;}
+            }
+            else
+            {t->held[k]=(down&KEY_BIT(k)) ? INPUT_STEPS : 0;}
+            if (t->pressed&KEY_BIT(k))
+            {
+                if (p>=end)
+                {ok=0;}
+                else
+                {t->age[k]=*p++;}
+            }
+        }
+        tick+=1;
+    }
+    free(buf);
+    r->nb_ticks=tick;
+    if (!ok)
+    {
+        replay_free(r);
+        return -1;
+    }
+    load_checks(r,path);
+    return 0;
+}
+
+void replay_free(Replay *r)
+{
+    int i;
+    for (i=0;i<r->nb_keys;i++)
+    {free(r->keys[i].data);}
+    for (i=0;i<r->nb_checks;i++)
+    {free(r->checks[i].data);}
+    free(r->keys);
+    free(r->checks);
+    free(r->hashes);
+    free(r->inputs);
+    memset(r,0,sizeof(Replay));
+}
+
+// premier ecart: l'etat enregistre le plus proche apres lui montre quels champs different
+static void report_divergence(const Replay *r,Game *g,Frame *f,FILE *out)
+{
+    Input_snapshot in;
+    Game *ref;
+    int i;
+    fprintf(out,"replay: l'etat differe de l'enregistrement a partir du tick %d (%d.%02d s)\n",
+            r->diverged,r->diverged*GAME_TICK_MS/1000,r->diverged*GAME_TICK_MS/10%100);
+    for (i=0;i<r->nb_checks && r->checks[i].tick<r->diverged;i++);
+    if (i==r->nb_checks)
+    {
+        fprintf(out,"  pas d'etat enregistre apres l'ecart\n");
+        return;
+    }
+    ref=(Game*)_mm_malloc(sizeof(Game),32);
+    if (ref==NULL || unpack(r->checks[i].data,r->checks[i].size,(unsigned*)ref,sizeof(Game)/sizeof(unsigned))!=0)
+    {
+        _mm_free(ref);
+        return;
+    }
+    while (g->tick<r->checks[i].tick)
+    {
+        input_expand(&r->inputs[g->tick],&in);
+        game_tick(g,&in,f);
+    }
+    fprintf(out,"  au tick %d, rejoue contre enregistre:\n",g->tick);
+    game_diff(out,g,ref,40);
+    _mm_free(ref);
+}
+
+int replay_index(Replay *r,Game *g,Frame *f,FILE *out)
+{
+    Input_snapshot in;
+    Game *copy=(Game*)_mm_malloc(sizeof(Game),32);
+    unsigned char *buf=(unsigned char*)malloc(PACK_MAX);
+    int ok=copy!=NULL && buf!=NULL;
+    game_reset(g,r->seed);
+    r->diverged=-1;
+    while (ok && g->tick<=r->nb_ticks)
+    {
+        if (g->tick%REPLAY_KEYFRAME==0)
+        {ok=add_key(&r->keys,&r->nb_keys,&r->cap_keys,g->tick,buf,pack_game(g,copy,buf))==0;}
+        if (r->diverged<0 && g->tick<r->nb_hashes && game_hash(g)!=r->hashes[g->tick])
+        {r->diverged=g->tick;}
+        if (g->tick==r->nb_ticks)
+        {break;}
+        input_expand(&r->inputs[g->tick],&in);
+        game_tick(g,&in,f);
+    }
+    _mm_free(copy);
+    free(buf);
+    if (ok && out!=NULL && r->diverged>=0)
+    {
+        g->seed=~r->seed;
+        replay_seek(r,g,r->diverged,f);
+        report_divergence(r,g,f,out);
+    }
+    else if (ok && out!=NULL && r->nb_hashes>0)
+    {fprintf(out,"replay: etat identique a l'enregistrement sur %d ticks\n",r->nb_hashes);}
+    return ok ? 0 : -1;
+}
+
+// ------------------------------------------------------------------ lecture
+
+int replay_seek(const Replay *r,Game *g,int tick,Frame *f)
+{
+    Input_snapshot in;
+    const Replay_key *k;
+    if (tick<0)
+    {tick=0;}
+    if (tick>r->nb_ticks)
+    {tick=r->nb_ticks;}
+    k=find_key(r->keys,r->nb_keys,tick);
+    if (k==NULL)
+    {return -1;}
+    // g sert de point de depart s'il est de cette partie, entre l'image cle et le tick voulu
+    if (g->seed!=r->seed || g->tick>tick || g->tick<k->tick)
+    {
+        if (unpack(k->data,k->size,(unsigned*)g,sizeof(Game)/sizeof(unsigned))!=0)
+        {return -1;}
+    }
+    while (g->tick<tick)
+    {
+        input_expand(&r->inputs[g->tick],&in);
+        game_tick(g,&in,f);
+    }
+    return 0;
+}
+
+void replay_report(FILE *f,const Replay *r)
+{
+    long long keys=0;
+    int i;
+    for (i=0;i<r->nb_keys;i++)
+    {keys+=r->keys[i].size;}
+    fprintf(f,"replay: graine %u, %d ticks (%d s), fichier de %lld octets (%.2f par seconde de jeu)%s\n",
+            r->seed,r->nb_ticks,r->nb_ticks*GAME_TICK_MS/1000,r->bytes,
+            r->nb_ticks>0 ? r->bytes*1000.0/((double)r->nb_ticks*GAME_TICK_MS) : 0.0,
+            r->same_build ? "" : ", AUTRE VERSION DU JEU: la partie peut diverger");
+    fprintf(f,"  %d images cles en memoire, %lld octets (%lld par image, %u brut)\n",
+            r->nb_keys,keys,r->nb_keys>0 ? keys/r->nb_keys : 0,(unsigned)sizeof(Game));
+    if (r->nb_hashes==0)
+    {fprintf(f,"  pas de controles (.chk): partie non verifiee\n");}
+    else
+    {fprintf(f,"  %d ticks controles, %d etats enregistres\n",r->nb_hashes,r->nb_checks);}
+}
@@ -0,0 +1,60 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "game.h"
+#include "input.h"
+
+// une partie enregistree: la graine et les changements d'entree, rien d'autre.
+// Fichier: en-tete (magique, empreinte de la version, graine, fenetre) puis un evenement
+// par tick ou une touche change: ecart en ticks (varint), touches qui changent (varint),
+// puis un octet par touche pour les fractions de tick. Un evenement sans touche clot le fichier.
+// A cote, <fichier>.chk: l'empreinte de l'etat avant chaque tick, et l'etat complet
+// compresse toutes les REPLAY_KEYFRAME, pour verifier que le jeu rejoue la meme partie
+#define REPLAY_KEYFRAME 500 // une image cle toutes les 5 s de jeu, refaites au chargement
+#define REPLAY_CHUNK 4096   // le thread d'ecriture recoit des blocs de cette taille
+
+// ecriture: un seul enregistrement a la fois; replay_write ne fait que coder en memoire,
+// un thread ecrit les blocs pleins sur le disque
+int replay_open(const char *path,int w,int h,unsigned seed);
+void replay_write(const Input_tick *t,const Game *g); // l'entree du tick g->tick, avant de le simuler
+int replay_close(); // attend la fin de l'ecriture; 0 si tout est sur le disque
+
+typedef struct
+{
+    int tick;               // l'etat juste avant ce tick
+    int size;
+    unsigned char *data;    // Game compresse
+} Replay_key;
+
+typedef struct
+{
+    unsigned seed;
+    int w,h;
+    int same_build;         // enregistre par cette version du jeu
+    long long bytes;        // taille du fichier
+    int nb_ticks;
+    Input_tick *inputs;     // inputs[t]: l'entree du tick t
+    int nb_keys;
+    int cap_keys;
+    Replay_key *keys;
+    int nb_hashes;          // controles enregistres (0: pas de fichier .chk)
+    unsigned *hashes;
+    int nb_checks;
+    Replay_key *checks;     // etats enregistres pendant la partie
+    int diverged;           // premier tick dont l'etat differe de l'enregistrement, -1 sinon
+} Replay;
+
+int replay_load(Replay *r,const char *path);
+void replay_free(Replay *r);
+// rejoue toute la partie une fois sans affichage pour poser les images cles, en comparant
+// chaque tick aux controles; au premier ecart, les champs qui different sont ecrits dans out
+int replay_index(Replay *r,Game *g,Frame *f,FILE *out);
+
+// amene g a l'etat d'avant le tick demande: depuis g s'il est deja sur le chemin,
+// sinon depuis l'image cle la plus proche, puis simulation sans affichage.
+// f recoit le dernier tick simule
+int replay_seek(const Replay *r,Game *g,int tick,Frame *f);
+
+void replay_report(FILE *f,const Replay *r);
+
+#endif
@@ -0,0 +1,370 @@
+#include "shots.h"
+#include "collision.h"
+#include "jobs.h"
+#include "profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+typedef int (*Shot_kernel)(Shot_pool *p,int xmin,int xmax,int ymin,int ymax,int *landed,int max_landed);
+
+static Shot_kernel shot_kernel=NULL;
+static const char *kernel_name="none";
+static int compress_lut[256][8]; // pour chaque masque, les voies gardees en tete
+
+int shots_init(Shot_pool *p,int cap)
+{
+    cap=(cap+7)&~7;
+    p->x=(int*)_mm_malloc(cap*sizeof(int),32);
+    p->y=(int*)_mm_malloc(cap*sizeof(int),32);
+    p->vx=(int*)_mm_malloc(cap*sizeof(int),32);
+    p->vy=(int*)_mm_malloc(cap*sizeof(int),32);
+    p->count=0;
+    p->cap=cap;
+    if (p->x==NULL || p->y==NULL || p->vx==NULL || p->vy==NULL)
+    {
+        shots_free(p);
+        return -1;
+    }
+    return 0;
+}
+
+void shots_free(Shot_pool *p)
+{
+    _mm_free(p->x);
+    _mm_free(p->y);
+    _mm_free(p->vx);
+    _mm_free(p->vy);
+    p->x=p->y=p->vx=p->vy=NULL;
+    p->count=0;
+    p->cap=0;
+}
+
+int shots_spawn(Shot_pool *p,int x,int y,int vx,int vy)
+{
+    int i=p->count;
+    if (i>=p->cap)
+    {return -1;}
+    p->x[i]=x;
+    p->y[i]=y;
+    p->vx[i]=vx;
+    p->vy[i]=vy;
+    p->count+=1;
+    return i;
+}
+
+// la derniere bal prend la place de la bal retiree
+void shots_remove(Shot_pool *p,int i)
+{
+    int last=p->count-1;
+    p->x[i]=p->x[last];
+    p->y[i]=p->y[last];
+    p->vx[i]=p->vx[last];
+    p->vy[i]=p->vy[last];
+    p->count=last;
+}
+
+// reference scalaire, sert aussi pour la fin des tableaux dans les noyaux SIMD
+static int update_range(Shot_pool *p,int i,int w,int xmin,int xmax,int ymin,int ymax,int *landed,int max_landed,int *nl)
+{
+    int sx,sy;
+    for (;i<p->count;i++)
+    {
+        sx=p->x[i]+p->vx[i];
+        sy=p->y[i]+p->vy[i];
+        if (sx<xmin || sx>xmax || sy<ymin)
+        {continue;}
+        if (sy>=ymax)
+        {
+            if (*nl<max_landed)
+            {landed[(*nl)++]=FX_INT(sx);}
+            continue;
+        }
+        p->x[w]=sx;
+        p->y[w]=sy;
+        p->vx[w]=p->vx[i];
+        p->vy[w]=p->vy[i];
+        w++;
+    }
+    return w;
+}
+
+int shots_update_scalar(Shot_pool *p,int xmin,int xmax,int ymin,int ymax,int *landed,int max_landed)
+{
+    int nl=0;
+    p->count=update_range(p,0,0,xmin,xmax,ymin,ymax,landed,max_landed,&nl);
+    return nl;
+}
+
+static int update_sse2(Shot_pool *p,int xmin,int xmax,int ymin,int ymax,int *landed,int max_landed)
+{
+    int *X=p->x,*Y=p->y,*VX=p->vx,*VY=p->vy;
+    int n=p->count,i=0,w=0,nl=0,j,m,ml;
+    __m128i lo=_mm_set1_epi32(xmin-1);
+    __m128i hi=_mm_set1_epi32(xmax+1);
+    __m128i top=_mm_set1_epi32(ymin-1);
+    __m128i bottom=_mm_set1_epi32(ymax);
+    int tx[4] __attribute__((aligned(16)));
+    int ty[4] __attribute__((aligned(16)));
+    int tvx[4] __attribute__((aligned(16)));
+    int tvy[4] __attribute__((aligned(16)));
+    for (;i+4<=n;i+=4)
+    {
+        __m128i vx=_mm_load_si128((const __m128i*)(VX+i));
+        __m128i vy=_mm_load_si128((const __m128i*)(VY+i));
+        __m128i x=_mm_add_epi32(_mm_load_si128((const __m128i*)(X+i)),vx);
+        __m128i y=_mm_add_epi32(_mm_load_si128((const __m128i*)(Y+i)),vy);
+        __m128i inx=_mm_and_si128(_mm_cmpgt_epi32(x,lo),_mm_cmplt_epi32(x,hi));
+        __m128i above=_mm_cmplt_epi32(y,bottom);
+        m=_mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128(_mm_and_si128(inx,above),_mm_cmpgt_epi32(y,top))));
+        // on ecrit toujours les 4 voies a w: w<=i donc rien n'est ecrase avant d'etre lu
+        if (m==15)
+        {
+            _mm_storeu_si128((__m128i*)(X+w),x);
+            _mm_storeu_si128((__m128i*)(Y+w),y);
+            _mm_storeu_si128((__m128i*)(VX+w),vx);
+            _mm_storeu_si128((__m128i*)(VY+w),vy);
+            w+=4;
+            continue;
+        }
+        _mm_store_si128((__m128i*)tx,x);
+        _mm_store_si128((__m128i*)ty,y);
+        _mm_store_si128((__m128i*)tvx,vx);
+        _mm_store_si128((__m128i*)tvy,vy);
+        for (j=0;j<4;j++)
+        {
+            X[w]=tx[j];
+            Y[w]=ty[j];
+            VX[w]=tvx[j];
+            VY[w]=tvy[j];
+            w+=(m>>j)&1;
+        }
+        ml=_mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(above,inx)));
+        for (j=0;ml!=0 && j<4;j++)
+        {
+            if (((ml>>j)&1) && nl<max_landed)
+            {landed[nl++]=FX_INT(tx[j]);}
+        }
+    }
+    p->count=update_range(p,i,w,xmin,xmax,ymin,ymax,landed,max_landed,&nl);
+    return nl;
+}
+
+__attribute__((target("avx2")))
+static int update_avx2(Shot_pool *p,int xmin,int xmax,int ymin,int ymax,int *landed,int max_landed)
+{
+    int *X=p->x,*Y=p->y,*VX=p->vx,*VY=p->vy;
+    int n=p->count,i=0,w=0,nl=0,j,m,ml;
+    __m256i lo=_mm256_set1_epi32(xmin-1);
+    __m256i hi=_mm256_set1_epi32(xmax+1);
+    __m256i top=_mm256_set1_epi32(ymin-1);
+    __m256i bottom=_mm256_set1_epi32(ymax);
+    int tx[8] __attribute__((aligned(32)));
+    for (;i+8<=n;i+=8)
+    {
+        __m256i vx=_mm256_load_si256((const __m256i*)(VX+i));
+        __m256i vy=_mm256_load_si256((const __m256i*)(VY+i));
+        __m256i x=_mm256_add_epi32(_mm256_load_si256((const __m256i*)(X+i)),vx);
+        __m256i y=_mm256_add_epi32(_mm256_load_si256((const __m256i*)(Y+i)),vy);
+        __m256i inx=_mm256_and_si256(_mm256_cmpgt_epi32(x,lo),_mm256_cmpgt_epi32(hi,x));
+        __m256i above=_mm256_cmpgt_epi32(bottom,y);
+        __m256i idx;
+        m=_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(_mm256_and_si256(inx,above),_mm256_cmpgt_epi32(y,top))));
+        ml=_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_andnot_si256(above,inx)));
+        if (ml!=0)
+        {
+            _mm256_store_si256((__m256i*)tx,x);
+            for (j=0;j<8;j++)
+            {
+                if (((ml>>j)&1) && nl<max_landed)
+                {landed[nl++]=FX_INT(tx[j]);}
+            }
+        }
+        // les voies gardees sont tassees en tete puis ecrites d'un bloc a w<=i
+        idx=_mm256_loadu_si256((const __m256i*)compress_lut[m]);
+        _mm256_storeu_si256((__m256i*)(X+w),_mm256_permutevar8x32_epi32(x,idx));
+        _mm256_storeu_si256((__m256i*)(Y+w),_mm256_permutevar8x32_epi32(y,idx));
+        _mm256_storeu_si256((__m256i*)(VX+w),_mm256_permutevar8x32_epi32(vx,idx));
+        _mm256_storeu_si256((__m256i*)(VY+w),_mm256_permutevar8x32_epi32(vy,idx));
+        w+=__builtin_popcount(m);
+    }
+    p->count=update_range(p,i,w,xmin,xmax,ymin,ymax,landed,max_landed,&nl);
+    return nl;
+}
+
+static void shots_pick_kernel()
+{
+    int m,j,k;
+    for (m=0;m<256;m++)
+    {
+        k=0;
+        for (j=0;j<8;j++)
+        {
+            if ((m>>j)&1)
+            {compress_lut[m][k++]=j;}
+        }
+        while (k<8)
+        {compress_lut[m][k++]=0;}
+    }
+    shot_kernel=update_sse2;
+    kernel_name="sse2";
+    if (__builtin_cpu_supports("avx2"))
+    {
+        shot_kernel=update_avx2;
+        kernel_name="avx2";
+    }
+}
+
+// un morceau de la pool par tache: chaque morceau est tasse sur place par le noyau,
+// puis les morceaux sont recolles dans l'ordre
+#define SHOTS_GRAIN 4096   // multiple de 8: les morceaux restent alignes pour les noyaux
+#define SHOTS_CHUNKS (SHOTS_MAX/SHOTS_GRAIN)
+#define SHOTS_CHUNK_LANDED 1024
+
+typedef struct
+{
+    Shot_pool *p;
+    int xmin,xmax,ymin,ymax;
+    int max_landed;
+    int kept[SHOTS_CHUNKS];
+    int nl[SHOTS_CHUNKS];
+    int landed[SHOTS_CHUNKS][SHOTS_CHUNK_LANDED];
+} Shot_job;
+
+static Shot_job shot_job;
+
+static void update_chunk(void *ctx,int chunk,int begin,int end)
+{
+    Shot_job *j=(Shot_job*)ctx;
+    Shot_pool part;
+    part.x=j->p->x+begin;
+    part.y=j->p->y+begin;
+    part.vx=j->p->vx+begin;
+    part.vy=j->p->vy+begin;
+    part.count=end-begin;
+    part.cap=part.count;
+    j->nl[chunk]=shot_kernel(&part,j->xmin,j->xmax,j->ymin,j->ymax,j->landed[chunk],j->max_landed);
+    j->kept[chunk]=part.count;
+}
+
+int shots_update(Shot_pool *p,int xmin,int xmax,int ymin,int ymax,int *landed,int max_landed)
+{
+    int nc,c,w,nl,k,src;
+    if (shot_kernel==NULL)
+    {shots_pick_kernel();}
+    if (jobs_threads()==1 || p->count<2*SHOTS_GRAIN || jobs_grain(p->count,SHOTS_GRAIN)!=SHOTS_GRAIN)
+    {return shot_kernel(p,xmin,xmax,ymin,ymax,landed,max_landed);}
+    shot_job.p=p;
+    shot_job.xmin=xmin;
+    shot_job.xmax=xmax;
+    shot_job.ymin=ymin;
+    shot_job.ymax=ymax;
+    shot_job.max_landed=max_landed<SHOTS_CHUNK_LANDED ? max_landed : SHOTS_CHUNK_LANDED;
+    nc=jobs_parallel_for(update_chunk,&shot_job,p->count,SHOTS_GRAIN);
+    w=shot_job.kept[0];
+    nl=0;
+    for (c=0;c<nc;c++)
+    {
+        if (c>0)
+        {
+            src=c*SHOTS_GRAIN;
+            memmove(p->x+w,p->x+src,shot_job.kept[c]*sizeof(int));
+            memmove(p->y+w,p->y+src,shot_job.kept[c]*sizeof(int));
+            memmove(p->vx+w,p->vx+src,shot_job.kept[c]*sizeof(int));
+            memmove(p->vy+w,p->vy+src,shot_job.kept[c]*sizeof(int));
+            w+=shot_job.kept[c];
+        }
+        for (k=0;k<shot_job.nl[c] && nl<max_landed;k++)
+        {landed[nl++]=shot_job.landed[c][k];}
+    }
+    p->count=w;
+    return nl;
+}
+
+const char *shots_kernel_name()
+{
+    if (shot_kernel==NULL)
+    {shots_pick_kernel();}
+    return kernel_name;
+}
+
+// remplit la pool jusqu'a n bals avec un generateur deterministe
+static void bench_fill(Shot_pool *p,int n,unsigned *seed)
+{
+    while (p->count<n)
+    {
+          *seed=*seed*1103515245u+12345u;
+          int sx=FX((int)(*seed>>8)%1280);
+          *seed=*seed*1103515245u+12345u;
+          int sy=FX((int)(*seed>>8)%860);
+          *seed=*seed*1103515245u+12345u;
+          int svx=(int)(*seed>>8)%FX(2)-FX(1);
+          *seed=*seed*1103515245u+12345u;
+          shots_spawn(p,sx,sy,svx,(int)(*seed>>8)%FX(2)-FX(1)/2);
+    }
+}
+
+// le budget de 2 ms vaut pour tout le chemin des bals d'un tick: le noyau, puis les corps
+// et le passage de collision contre l'avion, comme dans game_tick (boites seules, sans masque)
+static long long bench_collide(Broadphase *bp,Body *bodies,Bp_pair *pairs,Hit *hits,const Shot_pool *p,int tick)
+{
+    long long t0=prof_now_ns();
+    int i,n=0,xplane=(tick*5)%1180;
+    body_set(&bodies[n++],xplane,864,5,0,100,100,NULL,LAYER_PLANE,LAYER_ROCK,0);
+    for (i=0;i<p->count;i++)
+    {
+        body_set(&bodies[n++],FX_INT(p->x[i]),FX_INT(p->y[i]),FX_INT(p->x[i])-FX_INT(p->x[i]-p->vx[i]),
+                 FX_INT(p->y[i])-FX_INT(p->y[i]-p->vy[i]),80,50,NULL,LAYER_ROCK,LAYER_PLANE,i);
+    }
+    collide_pass(bp,bodies,n,pairs,1024,hits,256);
+    return prof_now_ns()-t0;
+}
+
+void shots_bench(FILE *f,int n,int ticks)
+{
+    Shot_pool ref,simd;
+    Broadphase bp;
+    Body *bodies;
+    Bp_pair pairs[1024];
+    Hit hits[256];
+    int landed_ref[1024],landed_simd[1024];
+    unsigned seed_ref=1,seed_simd=1;
+    long long t_ref=0,t_simd=0,t_pass=0,t0;
+    int t,same=1,nr,ns;
+    if (n>SHOTS_MAX)
+    {n=SHOTS_MAX;}
+    bodies=(Body*)malloc((n+1)*sizeof(Body));
+    if (bodies==NULL || shots_init(&ref,n)!=0 || shots_init(&simd,n)!=0 || bp_init(&bp,n+1,BP_SCENE_BURST)!=0)
+    {
+        fprintf(f,"shots bench: allocation impossible\n");
+        free(bodies);
+        return;
+    }
+    for (t=0;t<ticks;t++)
+    {
+        bench_fill(&ref,n,&seed_ref);
+        bench_fill(&simd,n,&seed_simd);
+        t0=prof_now_ns();
+        nr=shots_update_scalar(&ref,0,FX(1280),0,FX(864),landed_ref,1024);
+        t_ref+=prof_now_ns()-t0;
+        t0=prof_now_ns();
+        ns=shots_update(&simd,0,FX(1280),0,FX(864),landed_simd,1024);
+        t_simd+=prof_now_ns()-t0;
+        t_pass+=bench_collide(&bp,bodies,pairs,hits,&simd,t);
+        if (nr!=ns || ref.count!=simd.count || memcmp(landed_ref,landed_simd,nr*sizeof(int))!=0
+            || memcmp(ref.x,simd.x,ref.count*sizeof(int))!=0 || memcmp(ref.y,simd.y,ref.count*sizeof(int))!=0)
+        {same=0;}
+    }
+    fprintf(f,"shots bench: %d bals x %d ticks, %d thread(s)\n",n,ticks,jobs_threads());
+    fprintf(f,"  scalaire %9.1f us/tick\n",t_ref/1000.0/ticks);
+    fprintf(f,"  %-8s %9.1f us/tick  x%.2f  %s\n",kernel_name,t_simd/1000.0/ticks,
+            t_simd ? (double)t_ref/t_simd : 0.0,same ? "resultats identiques" : "RESULTATS DIFFERENTS");
+    fprintf(f,"  + corps et collisions (%s) %9.1f us/tick  (budget 2000 us pour le tout)  %s\n",bp_method_name(bp.method),
+            (t_simd+t_pass)/1000.0/ticks,(t_simd+t_pass)/ticks<=2000000 ? "tenu" : "DEPASSE");
+    bp_free(&bp);
+    free(bodies);
+    shots_free(&ref);
+    shots_free(&simd);
+}
@@ -0,0 +1,38 @@
+#ifndef SHOTS_H
+#define SHOTS_H
+
+#include <stdio.h>
+
+// virgule fixe 16.16 pour les bals ennemies
+#define FX_SHIFT 16
+#define FX(a) ((a)*(1<<FX_SHIFT))
+#define FX_INT(a) ((a)>>FX_SHIFT)
+
+#define SHOTS_MAX 65536
+
+// bals ennemies en SoA: tableaux alignes sur 32 octets, compactes en tete
+typedef struct
+{
+    int *x;
+    int *y;
+    int *vx;
+    int *vy;
+    int count;
+    int cap;
+} Shot_pool;
+
+int shots_init(Shot_pool *p,int cap);
+void shots_free(Shot_pool *p);
+int shots_spawn(Shot_pool *p,int x,int y,int vx,int vy); // 16.16, renvoie l'indice ou -1
+void shots_remove(Shot_pool *p,int i);
+
+// avance toutes les bals et retire en un seul passage celles qui sortent de
+// [xmin,xmax]x[ymin,..] ou qui atteignent ymax; l'abscisse (en pixels) des bals arrivees
+// en bas est copiee dans landed. Renvoie le nombre de bals arrivees en bas.
+int shots_update(Shot_pool *p,int xmin,int xmax,int ymin,int ymax,int *landed,int max_landed);
+int shots_update_scalar(Shot_pool *p,int xmin,int xmax,int ymin,int ymax,int *landed,int max_landed);
+const char *shots_kernel_name();
+
+void shots_bench(FILE *f,int n,int ticks); // noyau SIMD contre la reference scalaire
+
+#endif
@@ -0,0 +1,328 @@
+#include "stress.h"
+#include "broadphase.h"
+#include "collision.h"
+#include "motion.h"
+#include "particles.h"
+#include "profiler.h"
+#include "shots.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+enum
+{
+    STRESS_ALIENS,          // path_at de chaque ennemi
+    STRESS_SHOTS,           // emission et shots_update des bals
+    STRESS_PROJECTILES,     // les tirs du joueur montent
+    STRESS_COLLISION,       // collide_pass sur tous les corps
+    STRESS_PARTICLES,       // emission et particles_update
+    STRESS_DRAW,            // un sprite par entite
+    STRESS_PARTICLES_DRAW,  // effacement, dessin additif et collage
+    STRESS_NB
+};
+
+static const char *stress_names[STRESS_NB]={"aliens","shots","projectiles","collision","particles","draw","particles_draw"};
+
+#define STRESS_MAX_PAIRS 65536
+#define STRESS_MAX_HITS 4096
+#define STRESS_TRACE 50 // points de la courbe duree / nombre d'entites
+
+typedef struct
+{
+    int tick;               // -1: jamais
+    int aliens,shots,projectiles,particles;
+    long long ns[STRESS_NB];    // moyennes glissantes a ce tick
+    long long total;
+} Stress_point;
+
+typedef struct
+{
+    Path *paths;
+    int *ax,*ay,*ax_old,*ay_old;
+    int *px,*py;
+    Body *bodies;
+    Bp_pair *pairs;
+    Hit *hits;
+    Broadphase bp;
+    Shot_pool shots;
+    Particles particles;
+    Particle_layer layer;
+    int has_layer;
+} Stress_world;
+
+int stress_parse(Stress_config *c,const char *text)
+{
+    memset(c,0,sizeof(*c));
+    c->ticks=3000;
+    if (sscanf(text,"%d,%d,%d,%d,%d",&c->aliens,&c->shots,&c->projectiles,&c->particles,&c->ticks)<4)
+    {return -1;}
+    if (c->aliens<0 || c->shots<0 || c->projectiles<0 || c->particles<0 || c->ticks<=0)
+    {return -1;}
+    return 0;
+}
+
+static void world_free(Stress_world *w)
+{
+    free(w->paths);
+    free(w->ax);
+    free(w->ay);
+    free(w->ax_old);
+    free(w->ay_old);
+    free(w->px);
+    free(w->py);
+    free(w->bodies);
+    free(w->pairs);
+    free(w->hits);
+    bp_free(&w->bp);
+    shots_free(&w->shots);
+    particles_free(&w->particles);
+    if (w->has_layer)
+    {particles_layer_free(&w->layer);}
+}
+
+static int world_init(Stress_world *w,const Stress_config *c,const Bench_env *env)
+{
+    int n=c->aliens+1,bodies=2+c->aliens+c->projectiles+c->shots;
+    memset(w,0,sizeof(*w));
+    w->paths=(Path*)malloc(n*sizeof(Path));
+    w->ax=(int*)malloc(n*sizeof(int));
+    w->ay=(int*)malloc(n*sizeof(int));
+    w->ax_old=(int*)malloc(n*sizeof(int));
+    w->ay_old=(int*)malloc(n*sizeof(int));
+    w->px=(int*)malloc((c->projectiles+1)*sizeof(int));
+    w->py=(int*)malloc((c->projectiles+1)*sizeof(int));
+    w->bodies=(Body*)malloc(bodies*sizeof(Body));
+    w->pairs=(Bp_pair*)malloc(STRESS_MAX_PAIRS*sizeof(Bp_pair));
+    w->hits=(Hit*)malloc(STRESS_MAX_HITS*sizeof(Hit));
+    if (w->paths==NULL || w->ax==NULL || w->ay==NULL || w->ax_old==NULL || w->ay_old==NULL || w->px==NULL || w->py==NULL
+        || w->bodies==NULL || w->pairs==NULL || w->hits==NULL
+        || bp_init(&w->bp,bodies,BP_SCENE_SCREEN)!=0 || shots_init(&w->shots,c->shots+1)!=0
+        || particles_init(&w->particles,c->particles+1,0.95f,0.08f,255,120,30)!=0)
+    {
+        world_free(w);
+        return -1;
+    }
+    w->has_layer=env->sprite!=NULL && particles_layer_init(&w->layer,env->w,env->h)==0;
+    return 0;
+}
+
+static void launch(Stress_world *w,int i,int tick,int xmax,unsigned *seed)
+{
+    path_set(&w->paths[i],motion_rand(seed));
+    path_launch(&w->paths[i],tick);
+    path_at(&w->paths[i],tick,xmax,&w->ax[i],&w->ay[i]);
+}
+
+static void mean_point(Stress_point *p,int tick,const int *counts,long long window[][STRESS_NB],int filled)
+{
+    int i,k;
+    p->tick=tick;
+    p->aliens=counts[0];
+    p->shots=counts[1];
+    p->projectiles=counts[2];
+    p->particles=counts[3];
+    p->total=0;
+    for (i=0;i<STRESS_NB;i++)
+    {
+        p->ns[i]=0;
+        for (k=0;k<filled;k++)
+        {p->ns[i]+=window[k][i];}
+        p->ns[i]/=filled;
+        p->total+=p->ns[i];
+    }
+}
+
+static void print_point(FILE *f,const Stress_point *p)
+{
+    int i;
+    if (p->tick<0)
+    {
+        fprintf(f,"null");
+        return;
+    }
+    fprintf(f,"{\"tick\":%d,\"aliens\":%d,\"shots\":%d,\"projectiles\":%d,\"particles\":%d,\"ns\":%lld,\"phases\":{",
+            p->tick,p->aliens,p->shots,p->projectiles,p->particles,p->total);
+    for (i=0;i<STRESS_NB;i++)
+    {fprintf(f,"%s\"%s\":%lld",i>0 ? "," : "",stress_names[i],p->ns[i]);}
+    fprintf(f,"}}");
+}
+
+int stress_run(FILE *f,const Stress_config *c,const Bench_env *env)
+{
+    Stress_world w;
+    Stress_point first,phase_first[STRESS_NB],now;
+    long long window[STRESS_WINDOW][STRESS_NB];
+    long long ns[STRESS_NB],t0;
+    unsigned seed=BENCH_SEED;
+    int counts[4],entities[STRESS_NB];
+    int t,i,j,n,nb,nh,na=0,np=0,xplane,yplane=env->h*90/100,edge=env->h*9/10+env->alien->h-1,filled=0,trace=0;
+    if (world_init(&w,c,env)!=0)
+    {return -1;}
+    first.tick=-1;
+    for (i=0;i<STRESS_NB;i++)
+    {phase_first[i].tick=-1;}
+    fprintf(f,"{\"mode\":\"stress\",\"seed\":%u,\"budget_ns\":%lld,\"window\":%d,\"target\":{\"aliens\":%d,\"shots\":%d,\"projectiles\":%d,\"particles\":%d},\"ticks\":%d,\n\"trace\":[",
+            BENCH_SEED,STRESS_BUDGET_NS,STRESS_WINDOW,c->aliens,c->shots,c->projectiles,c->particles,c->ticks);
+    for (t=0;t<c->ticks;t++)
+    {
+        memset(ns,0,sizeof(ns));
+        memset(entities,0,sizeof(entities));
+        xplane=(t*5)%(2*(env->w-100));
+        if (xplane>=env->w-100)
+        {xplane=2*(env->w-100)-xplane;}
+
+        // ennemis: les nouveaux partent a ce tick, tous suivent leur trajectoire
+        t0=prof_now_ns();
+        n=(int)((long long)c->aliens*(t+1)/c->ticks);
+        for (;na<n;na++)
+        {launch(&w,na,t,env->w*9/10,&seed);}
+        for (i=0;i<na;i++)
+        {
+            w.ax_old[i]=w.ax[i];
+            w.ay_old[i]=w.ay[i];
+            path_at(&w.paths[i],t,env->w*9/10,&w.ax[i],&w.ay[i]);
+        }
+        ns[STRESS_ALIENS]=prof_now_ns()-t0;
+        entities[STRESS_ALIENS]=na;
+
+        // bals: regarnies jusqu'a la cible depuis les ennemis, puis le noyau du jeu
+        t0=prof_now_ns();
+        n=(int)((long long)c->shots*(t+1)/c->ticks);
+        while (w.shots.count<n)
+        {
+            i=na>0 ? (int)(motion_rand(&seed)%(unsigned)na) : -1;
+            shots_spawn(&w.shots,FX(i>=0 ? w.ax[i]+60 : (int)(motion_rand(&seed)%(unsigned)env->w)),FX(i>=0 ? w.ay[i]+100 : 0),
+                        (int)(motion_rand(&seed)%(unsigned)FX(1))-FX(1)/2,FX(1)+(int)(motion_rand(&seed)%(unsigned)FX(2)));
+        }
+        shots_update(&w.shots,FX(-200),FX(env->w+200),FX(-200),FX(env->h*9/10),NULL,0);
+        ns[STRESS_SHOTS]=prof_now_ns()-t0;
+        entities[STRESS_SHOTS]=w.shots.count;
+
+        // tirs du joueur: repartent de l'avion quand ils sortent par le haut
+        t0=prof_now_ns();
+        n=(int)((long long)c->projectiles*(t+1)/c->ticks);
+        for (;np<n;np++)
+        {
+            w.px[np]=xplane;
+            w.py[np]=yplane-(int)(motion_rand(&seed)%(unsigned)yplane);
+        }
+        for (i=0;i<np;i++)
+        {
+            w.py[i]-=3;
+            if (w.py[i]<-env->fireball->h)
+            {
+                w.px[i]=xplane;
+                w.py[i]=yplane;
+            }
+        }
+        ns[STRESS_PROJECTILES]=prof_now_ns()-t0;
+        entities[STRESS_PROJECTILES]=np;
+
+        // un seul passage pour tout: les contacts relancent l'ennemi et le tir
+        t0=prof_now_ns();
+        nb=0;
+        body_set(&w.bodies[nb++],xplane,yplane,5,0,env->plane->w,env->plane->h,env->plane,LAYER_PLANE,LAYER_ROCK,0);
+        body_set(&w.bodies[nb++],-200,edge,0,0,env->w+400,env->h,NULL,LAYER_EDGE,LAYER_ALIEN,0);
+        for (i=0;i<na;i++)
+        {
+            body_set(&w.bodies[nb++],w.ax[i],w.ay[i],w.ax[i]-w.ax_old[i],w.ay[i]-w.ay_old[i],env->alien->w,env->alien->h,
+                     env->alien,LAYER_ALIEN,LAYER_FIREBALL|LAYER_EDGE,i);
+        }
+        for (i=0;i<np;i++)
+        {
+            body_set(&w.bodies[nb++],w.px[i],w.py[i],0,-3,env->fireball->w,env->fireball->h,env->fireball,
+                     LAYER_FIREBALL,LAYER_ALIEN,i);
+        }
+        for (i=0;i<w.shots.count;i++)
+        {
+            body_set(&w.bodies[nb++],FX_INT(w.shots.x[i]),FX_INT(w.shots.y[i]),FX_INT(w.shots.vx[i]),FX_INT(w.shots.vy[i]),
+                     env->rock->w,env->rock->h,env->rock,LAYER_ROCK,LAYER_PLANE,i);
+        }
+        nh=collide_pass(&w.bp,w.bodies,nb,w.pairs,STRESS_MAX_PAIRS,w.hits,STRESS_MAX_HITS);
+        for (i=0;i<nh;i++)
+        {
+            const Body *A=&w.bodies[w.hits[i].a];
+            const Body *B=&w.bodies[w.hits[i].b];
+            if (A->layer==LAYER_FIREBALL && B->layer==LAYER_ALIEN)
+            {
+                launch(&w,B->id,t,env->w*9/10,&seed);
+                w.py[A->id]=-env->fireball->h-1;
+            }
+            else if (B->layer==LAYER_EDGE)
+            {launch(&w,A->id,t,env->w*9/10,&seed);}
+        }
+        ns[STRESS_COLLISION]=prof_now_ns()-t0;
+        entities[STRESS_COLLISION]=nb;
+
+        // particules: des explosions jusqu'a la cible
+        t0=prof_now_ns();
+        n=(int)((long long)c->particles*(t+1)/c->ticks);
+        while (w.particles.count<n)
+        {
+            particles_burst(&w.particles,(float)(motion_rand(&seed)%(unsigned)env->w),(float)(motion_rand(&seed)%(unsigned)(env->h*9/10)),
+                            n-w.particles.count<2500 ? n-w.particles.count : 2500,7.0f,45,&seed);
+        }
+        particles_update(&w.particles,env->w,env->h);
+        ns[STRESS_PARTICLES]=prof_now_ns()-t0;
+        entities[STRESS_PARTICLES]=w.particles.count;
+
+        if (env->sprite!=NULL)
+        {
+            t0=prof_now_ns();
+            env->sprite(env->ctx,BENCH_PLANE,xplane,yplane);
+            for (i=0;i<na;i++)
+            {env->sprite(env->ctx,BENCH_ALIEN,w.ax[i],w.ay[i]);}
+            for (i=0;i<np;i++)
+            {env->sprite(env->ctx,BENCH_FIREBALL,w.px[i],w.py[i]);}
+            for (i=0;i<w.shots.count;i++)
+            {env->sprite(env->ctx,BENCH_ROCK,FX_INT(w.shots.x[i]),FX_INT(w.shots.y[i]));}
+            ns[STRESS_DRAW]=prof_now_ns()-t0;
+            entities[STRESS_DRAW]=1+na+np+w.shots.count;
+        }
+        if (w.has_layer)
+        {
+            t0=prof_now_ns();
+            particles_erase(&w.layer);
+            particles_draw(&w.layer,&w.particles);
+            particles_present(&w.layer);
+            ns[STRESS_PARTICLES_DRAW]=prof_now_ns()-t0;
+            entities[STRESS_PARTICLES_DRAW]=w.particles.count;
+        }
+
+        // moyenne glissante: le premier depassement du budget, pour tout et par sous-systeme
+        memcpy(window[t%STRESS_WINDOW],ns,sizeof(ns));
+        if (filled<STRESS_WINDOW)
+        {filled++;}
+        counts[0]=na;
+        counts[1]=w.shots.count;
+        counts[2]=np;
+        counts[3]=w.particles.count;
+        mean_point(&now,t,counts,window,filled);
+        if (first.tick<0 && filled==STRESS_WINDOW && now.total>STRESS_BUDGET_NS)
+        {first=now;}
+        for (j=0;j<STRESS_NB;j++)
+        {
+            if (phase_first[j].tick<0 && filled==STRESS_WINDOW && now.ns[j]>STRESS_BUDGET_NS)
+            {phase_first[j]=now;}
+        }
+        if (t%(c->ticks/STRESS_TRACE>0 ? c->ticks/STRESS_TRACE : 1)==0 || t==c->ticks-1)
+        {
+            fprintf(f,"%s[%d,%lld,%d,%d,%d,%d]",trace>0 ? "," : "",t,now.total,na,w.shots.count,np,w.particles.count);
+            trace++;
+        }
+        if (now.total>8*STRESS_BUDGET_NS) // bien au-dela: la suite n'apprendrait rien
+        {break;}
+    }
+    fprintf(f,"],\n\"ticks_run\":%d,\"first_over\":",t<c->ticks ? t+1 : c->ticks);
+    print_point(f,&first);
+    fprintf(f,",\n\"subsystems\":{");
+    for (j=0;j<STRESS_NB;j++)
+    {
+        fprintf(f,"%s\n\"%s\":{\"entities_at_end\":%d,\"first_over\":",j>0 ? "," : "",stress_names[j],entities[j]);
+        print_point(f,&phase_first[j]);
+        fprintf(f,"}");
+    }
+    fprintf(f,"}}\n");
+    world_free(&w);
+    return first.tick>=0 ? 1 : 0;
+}
@@ -0,0 +1,28 @@
+#ifndef STRESS_H
+#define STRESS_H
+
+#include <stdio.h>
+#include "bench.h"
+
+// mode de charge: les sous-systemes du jeu sans ses plafonds (36 ennemis par vague,
+// NB_ALIENS cases, un seul tir). Les nombres montent lineairement de 0 a la cible pendant
+// ticks ticks; on note la duree de chaque tick par sous-systeme et le nombre d'entites
+// auquel l'image depasse STRESS_BUDGET_NS
+#define STRESS_BUDGET_NS 16666667LL // 60 images par seconde
+#define STRESS_WINDOW 15            // moyenne glissante sur ce nombre de ticks, contre les pics isoles
+
+typedef struct
+{
+    int aliens;         // N ennemis
+    int shots;          // M bals ennemies
+    int projectiles;    // P tirs du joueur
+    int particles;      // Q particules
+    int ticks;          // duree de la montee
+} Stress_config;
+
+// "N,M,P,Q" ou "N,M,P,Q,ticks"; 0 si la chaine est valable
+int stress_parse(Stress_config *c,const char *text);
+// resultat en JSON; rend 1 si le budget a ete depasse, 0 sinon, -1 si la memoire manque
+int stress_run(FILE *f,const Stress_config *c,const Bench_env *env);
+
+#endif
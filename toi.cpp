@@ -0,0 +1,186 @@
+#include "toi.h"
+
+#include <math.h>
+#include <string.h>
+
+int toi_init(Toi *q,int nb_bodies)
+{
+    memset(q,0,sizeof(Toi));
+    if (nb_bodies>TOI_MAX_BODIES)
+    {return -1;}
+    q->nb_bodies=nb_bodies;
+    return 0;
+}
+
+void toi_clear(Toi *q)
+{
+    int i;
+    for (i=0;i<q->nb_bodies;i++)
+    {
+        q->bodies[i].layer=0;
+        q->bodies[i].version+=1;
+    }
+    q->count=0;
+}
+
+static int fresh(const Toi *q,const Toi_event *e)
+{
+    return q->bodies[e->a].layer!=0 && q->bodies[e->b].layer!=0
+        && q->bodies[e->a].version==e->va && q->bodies[e->b].version==e->vb;
+}
+
+static void sift_up(Toi *q,int i)
+{
+    Toi_event e=q->heap[i];
+    while (i>0 && q->heap[(i-1)/2].tick>e.tick)
+    {
+        q->heap[i]=q->heap[(i-1)/2];
+        i=(i-1)/2;
+    }
+    q->heap[i]=e;
+}
+
+static void sift_down(Toi *q,int i)
+{
+    Toi_event e=q->heap[i];
+    int c;
+    for (;;)
+    {
+        c=2*i+1;
+        if (c>=q->count)
+        {break;}
+        if (c+1<q->count && q->heap[c+1].tick<q->heap[c].tick)
+        {c++;}
+        if (q->heap[c].tick>=e.tick)
+        {break;}
+        q->heap[i]=q->heap[c];
+        i=c;
+    }
+    q->heap[i]=e;
+}
+
+// tas plein: on jette les predictions perimees
+static int make_room(Toi *q)
+{
+    int i,w=0;
+    for (i=0;i<q->count;i++)
+    {
+        if (fresh(q,&q->heap[i]))
+        {q->heap[w++]=q->heap[i];}
+    }
+    q->stale+=q->count-w;
+    q->count=w;
+    for (i=q->count/2-1;i>=0;i--)
+    {sift_down(q,i);}
+    return q->count<TOI_MAX_EVENTS ? 0 : -1;
+}
+
+// restreint [lo,hi] aux s>=0 tels que k*s<c
+static void limit(float k,float c,float *lo,float *hi)
+{
+    if (k==0)
+    {
+        if (c<=0)
+        {*lo=HUGE_VALF;}
+    }
+    else if (k>0)
+    {
+        if (c/k<*hi)
+        {*hi=c/k;}
+    }
+    else if (c/k>*lo)
+    {*lo=c/k;}
+}
+
+// premier instant apres now ou les deux boites elargies peuvent se chevaucher;
+// rien n'est empile si elles ne se rencontrent jamais. first: premier tick pas encore teste
+static void predict(Toi *q,int a,int b,int now,int first)
+{
+    const Toi_body *A=&q->bodies[a],*B=&q->bodies[b];
+    float ax=A->x+A->vx*(now-A->t0),ay=A->y+A->vy*(now-A->t0);
+    float bx=B->x+B->vx*(now-B->t0),by=B->y+B->vy*(now-B->t0);
+    float lo=0,hi=HUGE_VALF;
+    Toi_event e;
+    // sur chaque axe: a.debut < b.fin et b.debut < a.fin, les deux bornes bougent avec le temps
+    limit(A->vx-B->vx,bx+B->w+B->mx+A->mx-ax,&lo,&hi);
+    limit(B->vx-A->vx,ax+A->w+A->mx+B->mx-bx,&lo,&hi);
+    limit(A->vy-B->vy,by+B->h+B->my+A->my-ay,&lo,&hi);
+    limit(B->vy-A->vy,ay+A->h+A->my+B->my-by,&lo,&hi);
+    q->predictions+=1;
+    if (lo>hi || lo>(float)(1<<30))
+    {return;}
+    e.tick=now+(int)ceilf(lo);
+    if (e.tick<first)
+    {e.tick=first;}
+    e.a=a;
+    e.b=b;
+    e.va=A->version;
+    e.vb=B->version;
+    if (q->count>=TOI_MAX_EVENTS && make_room(q)!=0)
+    {
+        q->dropped+=1;
+        return;
+    }
+    q->heap[q->count]=e;
+    sift_up(q,q->count++);
+}
+
+void toi_set(Toi *q,int id,const Toi_body *b)
+{
+    int j;
+    unsigned version=q->bodies[id].version+1;
+    q->bodies[id]=*b;
+    q->bodies[id].version=version;
+    for (j=0;j<q->nb_bodies;j++)
+    {
+        if (j!=id && q->bodies[j].layer!=0
+            && ((b->collides&q->bodies[j].layer) || (q->bodies[j].collides&b->layer)))
+        {predict(q,id,j,b->t0,b->t0);}
+    }
+}
+
+void toi_remove(Toi *q,int id)
+{
+    if (q->bodies[id].layer!=0)
+    {
+        q->bodies[id].layer=0;
+        q->bodies[id].version+=1;
+    }
+}
+
+int toi_due(Toi *q,int tick,Bp_pair *pairs,int max_pairs)
+{
+    int n=0;
+    while (q->count>0 && q->heap[0].tick<=tick && n<max_pairs)
+    {
+        Toi_event e=q->heap[0];
+        q->heap[0]=q->heap[--q->count];
+        if (q->count>0)
+        {sift_down(q,0);}
+        if (!fresh(q,&e))
+        {
+            q->stale+=1;
+            continue;
+        }
+        pairs[n].a=e.a;
+        pairs[n].b=e.b;
+        n++;
+    }
+    q->tests+=n;
+    return n;
+}
+
+void toi_repredict(Toi *q,int a,int b,int tick)
+{
+    if (q->bodies[a].layer!=0 && q->bodies[b].layer!=0)
+    {predict(q,a,b,tick,tick+1);}
+}
+
+void toi_report(FILE *f,const Toi *q)
+{
+    fprintf(f,"contacts programmes: %lld predictions, %lld paires testees, %lld perimees, %d en attente",
+            q->predictions,q->tests,q->stale,q->count);
+    if (q->dropped>0)
+    {fprintf(f,", %lld PERDUES (file pleine)",q->dropped);}
+    fprintf(f,"\n");
+}
@@ -0,0 +1,61 @@
+#ifndef TOI_H
+#define TOI_H
+
+#include <stdio.h>
+#include "broadphase.h"
+
+// trajectoire connue d'un corps: une droite, plus un ecart borne autour d'elle
+// (une trajectoire analytique qui ondule tient dans sa droite moyenne elargie de son amplitude)
+typedef struct
+{
+    float x,y;      // coin haut gauche sur la droite, au tick t0
+    float vx,vy;    // px par tick
+    float mx,my;    // ecart maximal a la droite, px
+    int w,h;
+    int t0;
+    int layer;      // 0: pas de corps
+    int collides;   // couches avec lesquelles il interagit
+    unsigned version;   // change a chaque nouvelle trajectoire
+} Toi_body;
+
+typedef struct
+{
+    int tick;           // premier tick ou le contact devient possible
+    int a,b;
+    unsigned va,vb;     // versions au moment de la prediction, perimee sinon
+} Toi_event;
+
+#define TOI_MAX_BODIES 64
+#define TOI_MAX_EVENTS 1024 // au plus une prediction a jour par paire, le reste est perime
+
+// file de contacts possibles, triee sur le tick (tas binaire):
+// on ne teste une paire que quand elle peut se toucher.
+// Sans pointeur: elle se copie avec l'etat du jeu
+typedef struct
+{
+    Toi_body bodies[TOI_MAX_BODIES];
+    int nb_bodies;
+    Toi_event heap[TOI_MAX_EVENTS];
+    int count;
+    long long predictions;
+    long long stale;    // predictions jetees, trajectoire changee entre temps
+    long long tests;    // paires rendues a tester
+    long long dropped;  // file pleine de predictions a jour
+} Toi;
+
+int toi_init(Toi *q,int nb_bodies);
+void toi_clear(Toi *q);
+
+// nouvelle trajectoire pour le corps id (le tick de b->t0): les predictions d'avant sont
+// perimees et le contact avec chaque corps qui interagit est predit a nouveau
+void toi_set(Toi *q,int id,const Toi_body *b);
+void toi_remove(Toi *q,int id);
+
+// paires dont le contact est possible au tick donne; chaque paire rendue doit etre
+// testee puis repredite avec toi_repredict, qu'elle ait touche ou non
+int toi_due(Toi *q,int tick,Bp_pair *pairs,int max_pairs);
+void toi_repredict(Toi *q,int a,int b,int tick);
+
+void toi_report(FILE *f,const Toi *q);
+
+#endif